@@ -50,11 +50,13 @@
  * NOTES
  *
  * -----------------------------------------------
- * Signals
+ * Built-in command requests
  * -----------------------------------------------
- * The main signals used are SIGUSR1 and SIGUSR2:
- *  - SIGUSR1 can be sent only be root process
- *  - SIGUSR2 can be received only by root process
+ * Built-in commands that change the shell's state
+ * ( cd, set, ... ) must run in the main process:
+ *  - children send requests on $SH_IPC_FD
+ *  - only main process serves them, while waiting
+ *  - signals are events of the same loop
  * -----------------------------------------------
  *
  */
@@ -71,741 +73,1072 @@ bool sh_cmd_isempty ( sh_cmd_t *cmd ) {
 }
 bool sh_cmd_isvalid ( sh_cmd_t *cmd ) {
 
-    // Vars
-    pid_t pid;
-    char *result, *result_f;
-
     // If cmd is empty is always not valid
     if ( cmd->utils->isempty( cmd ) ) return false;
 
     // If cmd is builtin, always passes this validity test
     if ( cmd->is_blt && NULL != cmd->bltcmd->cmd ) return true;
 
-    // Create a pipe
-    int pd[2];
-    if ( pipe( pd ) < 0 ) {
+    // Command is valid if it resolves to an executable ( via the PATH index )
+    return NULL != sh_path_lookup( cmd->cmd );
 
-        // Report Error
-        fprintf( stdout, "\t@sh_cmd_isvalid(): pipe() error: %s\n", strerror( errno ) );
+}
+void sh_cmd_parse ( sh_cmd_t *cmd ) {
 
-        // Return false to invalidate command
-        return false;
+    // Check if already parsed
+    if ( cmd->is_prs ) return;
 
-    }
+    // Arguments ( $cmd->args ) have been materialized by sh_row_parse()
 
-    // Fork
-    pid = fork();
-    if ( pid < 0 ) {
+    //
+    // Check if command is a built-in command
+    // Also, assign the sh_bltcmd_t command to $cmd->bltcmd
+    // The struct sh_bltcmd_t defines two fields: the command name and a function
+    cmd->bltcmd = sh_blt_lookup( cmd->cmd );
+    cmd->is_blt = NULL != cmd->bltcmd;
 
-        // Print error in stdout
-        fprintf( stdout, "\t@sh_cmd_isvalid(): fork() error: %s\n", strerror( errno ) );
+    // DEBUGGING:
+    if ( SH_DBG( 2 ) ) {
+        if ( cmd->is_blt ) fprintf( stdout, "\t@sh_cmd_parse(): IS a built-in command ( '%s' )\n", cmd->cmd );
+        else fprintf( stdout, "\t@sh_cmd_parse(): NOT a built-in command\n" );
+    }
 
-        // Return false to inform for failure
-        return false;
+    // Inform state
+    cmd->is_prs = true;
 
-    }
+}
+void sh_cmd_inspect ( sh_cmd_t *cmd ) {
 
-    // Child process execs system() command
-    if ( pid == 0 ) {
+    // Opening text
+    fprintf( stdout, "\t@sh_cmd_inspect(): command inspection start\n" );
 
-        // The write edge of the pipe should from now on be equal to stdout
-        dup2( *( pd + WRITE_EDGE ), STDOUT_FILENO );
+    // Echo command and data
+    fprintf( stdout, "\t\t--%s--\n\t\t\tempty: %s\n\t\t\tvalid: %s\n", cmd->cmd,
+             cmd->utils->isempty( cmd ) ? "YES" : "NO", cmd->utils->isvalid( cmd ) ? "YES" : "NO" );
 
-        // Close descriptors
-        close( *( pd + READ_EDGE ) );
-        close( *( pd + WRITE_EDGE ) );
+    // Echo Args
+    fprintf( stdout, "\t\t-args ( %zu ):\n", cmd->nargs );
+    for ( size_t j = 0; j < cmd->nargs; j++ )
+        fprintf( stdout, "\t\t\targ[%zu]: %s\n", j, *( cmd->args + j ) );
 
-        // Create query string
-        char *bs = ( char * ) calloc( strlen( "type" ) + strlen( cmd->cmd ) + 2, sizeof( char ) );
-        if ( NULL == bs ) {
+    // Echo glues
+    fprintf( stdout, "\t\t-glues:\n" );
+    fprintf( stdout, "\t\t\tbef: '%s'\n", cmd->glue_b );
+    fprintf( stdout, "\t\t\taft: '%s'\n", cmd->glue_a );
 
-            // Echo error
-            fprintf( stdout, "\t@sh_cmd_isvalid(): calloc for $bs in child failed: %s\n", strerror( errno ) );
+    // Echo props
+    fprintf( stdout, "\t\t-props:\n" );
+    fprintf( stdout, "\t\t\tparsed: '%s'\n", cmd->is_prs ? "YES" : "NO" );
+    fprintf( stdout, "\t\t\tis_blt: '%s'\n", cmd->is_blt ? "YES" : "NO" );
 
-            // Return failure
-            _exit( EXIT_FAILURE );
+    // Echo associated built-in command's name
+    fprintf( stdout, "\t\t-blt:\n" );
+    fprintf( stdout, "\t\t\tbltcmd: '%s'\n", cmd->is_blt ? cmd->bltcmd->cmd : "(null)" );
 
-        }
+    // Closing text
+    fprintf( stdout, "\t@sh_cmd_inspect(): command inspection stop\n" );
 
-        // Search for command
-        sprintf( bs, "type %s\n", cmd->cmd );
-        system( bs );
+}
 
-        // Free resources
-        free( bs );
+/*
+ * ------------------
+ * Shell Row methods
+ * ------------------
+ *
+ */
+bool sh_row_iscomment ( sh_row_t *row ) {
+    return *row->raw == '#';
+}
+/*
+ * Parse row
+ * Extract commands and the way commands are joined to each other, forming a shell_row_t object
+ */
+void sh_row_parse ( sh_row_t *row ) {
 
-        // Exit child process
-        _exit( EXIT_SUCCESS );
+    // Vars
+    size_t i, j, len, nargv;
+    sh_scmd_t *scmd;
+    sh_cmd_t *cmd;
+    const sh_tok_t *tok;
+    char **argv, *buf;
 
-        // Parent process reads result and compares to result on failure
-    } else {
+    // Init
+    row->ncmds = 0;
+    row->cmds = NULL;
+    len = strlen( row->raw );
 
-        // Parent only reads to read
-        close( *( pd + WRITE_EDGE ) );
+    // Scan row: commands, their arguments and the delimiters between them
+    if ( !sh_scan( &SH_ARENA, row->raw, len, &row->scan ) ) {
 
-        // Get result of child's job via pipe's READ_EDGE
-        result = ( char * ) calloc( 100, sizeof( char ) );
-        if ( NULL == result ) {
+        // Echo error
+        fprintf( stdout, "\t@parse(): sh_scan failed: %s\n", strerror( errno ) );
 
-            // Echo error
-            fprintf( stdout, "\t@sh_cmd_isvalid(): calloc for $result in parent failed: %s\n", strerror( errno ) );
+        // Return failure
+        return;
 
-            // Close read edge
-            close( *( pd + READ_EDGE ) );
+    }
 
-            // Return failure
-            return false;
+    // Allocate commands, their argv arrays ( each NULL-terminated ) and a copy of $row->raw the arguments point into
+    nargv = row->scan.ntoks + row->scan.ncmds;
+    row->cmds = ( sh_cmd_t * ) sh_arena_alloc( &SH_ARENA, row->scan.ncmds * sizeof( sh_cmd_t ) +
+                                                          nargv * sizeof( char * ) + len + 1 );
+    if ( NULL == row->cmds ) {
 
-        }
+        // Echo error
+        fprintf( stdout, "\t@parse(): sh_arena_alloc for $row->cmds failed: %s\n", strerror( errno ) );
 
-        int i = 0;
-        while ( read( *( pd + READ_EDGE ), ( result + i++ ), 1 ) > 0 );
+        // Return failure
+        return;
 
-        // The whole pipe was read
-        close( *( pd + READ_EDGE ) );
+    }
+    argv = ( char ** ) ( row->cmds + row->scan.ncmds );
+    buf = ( char * ) ( argv + nargv );
+    memcpy( buf, row->raw, len + 1 );
 
-        // Compare to result on failure
-        result_f = ( char * ) calloc( 100, sizeof( char ) );
-        if ( NULL == result ) {
+    // Get Commands
+    for ( i = 0; i < row->scan.ncmds; ++i ) {
 
-            // Echo error
-            fprintf( stdout, "\t@sh_cmd_isvalid(): calloc for $result in parent failed: %s\n", strerror( errno ) );
+        // Init
+        scmd = row->scan.cmds + i;
+        cmd = row->cmds + i;
 
-            // Close read edge
-            close( *( pd + READ_EDGE ) );
+        // Materialize arguments in place: the byte after a slice is never part of another slice
+        cmd->args = argv;
+        for ( j = 0; j < scmd->ntoks; ++j ) {
 
-            // Return failure
-            return false;
+            tok = row->scan.toks + scmd->tok + j;
+            *( buf + tok->off + tok->len ) = '\0';
+            *( argv + j ) = buf + tok->off;
 
         }
-        sprintf( result_f, "%s: not found\n", cmd->cmd );
 
-        // Get result
-        bool cmp = strcmp( result, result_f ) == 0 ? false : true;
+        // Last arg should be null-termination for compatibility with execvp()
+        *( argv + j++ ) = ( char * ) 0;  // ARGS_END
+        cmd->nargs = j;
+        argv += j;
 
-        // Free resources
-        free( result );
-        free( result_f );
+        // Single command init ( first arg is command's name )
+        cmd->cmd = *cmd->args;
+
+        // Set utils
+        cmd->utils = cmdutils;
+        cmd->is_prs = false;
 
-        // Return the comparison of retrieved result with the failure's result
-        return cmp;
+        // Set glues
+        // 1 ) Before
+        cmd->glue_b = i == 0 ? "" : ( cmd - 1 )->glue_a;
+        // 2 ) After
+        cmd->glue_a = SH_OP_NONE == scmd->op ? "" : *( DEL_ARR + scmd->op );
+
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) && SH_OP_NONE != scmd->op )
+            fprintf( stdout, "\t@parse(): delimiter found: '%s'\n", cmd->glue_a );
 
     }
 
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@parse(): %zu commands parsed\n", i );
+
+    // Assign total nb
+    row->ncmds = i;
+
+    // Build execution plan
+    sh_row_plan( row );
+
 }
-void sh_cmd_trim ( sh_cmd_t *cmd ) {
+/*
+ * Build row's execution plan
+ *
+ * The plan is a tree of sh_node_t, with bash's grammar and associativity:
+ *  - a pipeline is a leaf: a run of contiguous commands joined by '|'
+ *  - pipelines joined by '&&' / '||' form an and-or list ( left-associative, same precedence )
+ *  - and-or lists joined by ';' form the row, an and-or list followed by '&' is run in background
+ *
+ * Sequences are built right-deep, so that sh_exec_plan() walks them in a loop. A dangling '|', '&&' or '||' at the
+ * end of row is ignored.
+ *
+ */
+void sh_row_plan ( sh_row_t *row ) {
 
     // Vars
-    char dest[strlen( cmd->cmd )], *orig;
-    size_t i, left, right, len;
+    size_t i, n, first, ifirst, andor, item, pending, *link;
+    sh_op_t op, join;
+    sh_node_t *nodes;
 
     // Init
-    i = 0;
-    left = 0;
-    orig = cmd->cmd;
+    row->plan = NULL;
+    row->nnodes = 0;
+    row->root = SIZE_MAX;
+    if ( 0 == row->ncmds ) return;
 
-    // Replace multiple spaces with single space
-    // While we're not at the end of the string, loop...
-    while ( *cmd->cmd != '\0' ) {
+    // At most one pipeline, one '&&' / '||', one '&' and one ';' node per command
+    nodes = ( sh_node_t * ) sh_arena_alloc( &SH_ARENA, 4 * row->ncmds * sizeof( sh_node_t ) );
+    if ( NULL == nodes ) {
 
-        // Remove double spaces
-        // Loop while the current character is a space, and the next
-        // character is a space
-        while ( *cmd->cmd == ' ' && *( cmd->cmd + 1 ) == ' ' ) cmd->cmd++; // skip to next character
+        // Echo error
+        fprintf( stdout, "\t@sh_row_plan(): sh_arena_alloc for $nodes failed: %s\n", strerror( errno ) );
 
-        // Copy from the "source" string to the "destination" string,
-        // while advancing to the next character in both
-        *( dest + i++ ) = *cmd->cmd++;
+        // Return failure ( nothing will be executed )
+        return;
 
     }
-    *( dest + i ) = '\0';
-
-    // Init vars
-    len = strlen( dest );
-    right = len;
-
-    // Trim leading non alphanumerics
-    i = 0;
-    while ( !isalnum( *( dest + i++ ) ) && left++ );
 
-    // Trim trailing non alphanumerics
-    i = 1;
-    while ( !( isalnum( *( dest + len - i++ ) ) || '.' == *( dest + len - ( i - 1 ) ) ) && right > 0 && right-- );
+    n = 0;
+    first = ifirst = 0;     // first command of current pipeline / and-or list
+    andor = SIZE_MAX;       // current and-or list's node
+    join = SH_OP_NONE;      // operator joining $andor and the next pipeline
+    pending = SIZE_MAX;     // last complete list item, not linked yet
+    link = &row->root;      // where the next list item will be linked
+
+    for ( i = 0; i < row->ncmds; ++i ) {
+
+        // Get operator after command
+        op = ( row->scan.cmds + i )->op;
+        if ( i == row->ncmds - 1 && ( SH_OP_PIPE == op || SH_OP_AND == op || SH_OP_OR == op ) ) op = SH_OP_NONE;
+        if ( SH_OP_PIPE == op ) continue;
+
+        // Pipeline ends here
+        ( nodes + n )->op = SH_OP_PIPE;
+        ( nodes + n )->lhs = first;
+        ( nodes + n )->rhs = i - first + 1;
+        first = i + 1;
+
+        // Join to current and-or list
+        if ( SIZE_MAX == andor ) andor = n++;
+        else {
+            ( nodes + n + 1 )->op = join;
+            ( nodes + n + 1 )->lhs = andor;
+            ( nodes + n + 1 )->rhs = n;
+            andor = n + 1;
+            n += 2;
+        }
+        if ( SH_OP_AND == op || SH_OP_OR == op ) {
+            join = op;
+            continue;
+        }
 
-    // FIX: empty string of non-alphanumerics
-    if ( right < left ) right = left;
+        // List item ends here
+        item = andor;
+        andor = SIZE_MAX;
+        if ( SH_OP_BG == op ) {
+            ( nodes + n )->op = SH_OP_BG;
+            ( nodes + n )->lhs = item;
+            ( nodes + n )->rhs = first - ifirst;
+            item = n++;
+        }
+        ifirst = first;
+
+        // Link previous item in a sequence
+        if ( SIZE_MAX != pending ) {
+            ( nodes + n )->op = SH_OP_SEQ;
+            ( nodes + n )->lhs = pending;
+            *link = n;
+            link = &( nodes + n++ )->rhs;
+        }
+        pending = item;
 
-    // Reallocate $cmd->cmd to prevent memory leaks
-    cmd->cmd = ( char * ) realloc( orig, right - left + 1 );
+    }
+    *link = pending;
 
-    // Copy part of initial command string to $trimmed
-    memmove( ( void * ) cmd->cmd, ( void * ) dest + left, ( right - left ) );
-    *( cmd->cmd + right - left ) = '\0';
+    // Assign plan
+    row->plan = nodes;
+    row->nnodes = n;
 
     // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-        fprintf( stdout, "\t@trim(): command after sh_cmd_trim: --%s--\n", cmd->cmd );
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_row_plan(): %zu nodes planned\n", n );
 
 }
-void sh_cmd_parse ( sh_cmd_t *cmd ) {
+void sh_row_inspect ( sh_row_t *row ) {
 
-    // Check if already parsed
-    if ( cmd->is_prs ) return;
+    // Opening text
+    fprintf( stdout, "\t@inspect(): row inspection start\n" );
 
-    // Check if empty
-    if ( cmd->utils->isempty( cmd ) ) {
+    // Inspect commands
+    for ( size_t i = 0; i < row->ncmds; i++ ) {
 
-        // Set as empty command
-        cmd->cmd = "";
+        // Before parsing
+        fprintf( stdout, "\tRAW: --%.*s--\n\tPARSED:\n", ( int ) ( row->scan.cmds + i )->len,
+                 row->raw + ( row->scan.cmds + i )->off );
 
-        // Set terminating-only arg
-        cmd->args = ( char ** ) calloc( 1, ARG_LEN_MAX );
-        if ( NULL == cmd->args ) {
+        // Parse
+        ( row->cmds + i )->utils->parse( row->cmds + i );
 
-            // Echo error
-            fprintf( stdout, "\t@sh_cmd_parse(): calloc for $cmd->args ( cmd is empty ) failed: %s\n",
-                     strerror( errno ) );
+        // Inspect
+        if ( SH_DBG( 1 ) )
+            ( row->cmds + i )->utils->inspect( row->cmds + i );
 
-            // Return failure
-            return;
+    }
 
-        }
+    // Closing text
+    fprintf( stdout, "\t@inspect(): row inspection stop\n" );
 
-        *cmd->args = NULL;  // ARGS_END
-        cmd->nargs = 1;
+}
+bool sh_row_exec ( sh_row_t *row ) {
 
-        // Inform state & return
-        cmd->is_prs = true;
-        return;
+    // Print formal params
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@exec(): executing row's commands ( raw: --%s-- )\n", row->raw );
 
-    }
+    // Empty row ( or no plan ) always succeeds
+    if ( NULL == row->plan || SIZE_MAX == row->root ) return true;
 
-    // Vars
-    char *arg, *raw;
-    size_t nargs, i;
+    // Walk plan from its root
+    // Whole row's execution result will be shell's output status
+    return sh_exec_plan( row, row->root );
 
-    // Get number of args ( cmd is the 1st token )
-    nargs = sh_ntokens( cmd->cmd, CMD_DEL ) - 1;
+}
+/*
+ * ------
+ * Arena
+ * ------
+ *
+ * All memory of a row ( its copy, scan, commands, arguments, pipe channels and pids ) is bumped out of $SH_ARENA.
+ * sh_parse_exec_row() takes a mark before parsing and releases it after execution, which frees the whole row in
+ * one step. Rows nested in a row ( e.g. a batch file run by a failed command ) stack on top of it.
+ *
+ * Released chunks stay in the arena, so in steady state rows are parsed and executed without calling malloc().
+ * When the arena is emptied, chunks beyond ARENA_KEEP_LEN are returned to the system.
+ *
+ */
+#define sh_arena_round( n ) ( ( ( n ) + ARENA_ALIGN - 1 ) & ~( size_t ) ( ARENA_ALIGN - 1 ) )
+#define sh_chunk_data( c ) ( ( char * ) ( c ) + sh_arena_round( sizeof( sh_chunk_t ) ) )
 
-    // Copy to $raw for processing
-    raw = strdup( cmd->cmd );
-    if ( NULL == raw ) {
+/*
+ * Allocate $len bytes ( uninitialized, aligned to ARENA_ALIGN )
+ *
+ * @return [void *]: The memory or NULL if a new chunk could not be allocated
+ */
+void *sh_arena_alloc ( sh_arena_t *arena, size_t len ) {
 
-        // Report error
-        fprintf( stdout, "\t@sh_cmd_parse(): strdup for $raw failed: %s\n", strerror( errno ) );
+    // Vars
+    sh_chunk_t *chunk, **link;
+    size_t size;
 
-        // Exit reporting failure
-        return;
+    // Init
+    len = sh_arena_round( len );
 
-    }
+    // Serve from current chunk, else from the next free chunk that fits
+    for ( chunk = arena->cur; NULL != chunk; chunk = chunk->next ) {
 
-    // Get command
-    cmd->cmd = strsep( &raw, CMD_DEL );
+        if ( chunk != arena->cur ) chunk->used = 0;
+        if ( chunk->size - chunk->used >= len ) break;
 
-    // Init cmd->args
-    cmd->args = ( char ** ) calloc( nargs, ARG_LEN_MAX );
-    if ( NULL == cmd->args ) {
+    }
 
-        // Echo error
-        fprintf( stdout, "\t@sh_cmd_parse(): calloc for $cmd->args failed: %s\n", strerror( errno ) );
+    // Append a new chunk
+    if ( NULL == chunk ) {
 
-        // Free resources used
-        free( raw );
+        size = len > ARENA_CHUNK_LEN ? len : ARENA_CHUNK_LEN;
+        chunk = ( sh_chunk_t * ) malloc( sh_arena_round( sizeof( sh_chunk_t ) ) + size );
+        if ( NULL == chunk ) return NULL;
 
-        // Return failure
-        return;
+        chunk->next = NULL;
+        chunk->size = size;
+        chunk->used = 0;
+        for ( link = &arena->head; NULL != *link; link = &( *link )->next );
+        *link = chunk;
 
     }
 
-    // Get args
-    // First arg is command's name
-    *cmd->args = strdup( cmd->cmd );
-    if ( NULL == *cmd->args ) {
+    // Bump
+    arena->cur = chunk;
+    chunk->used += len;
+    return sh_chunk_data( chunk ) + chunk->used - len;
 
-        // Report error
-        fprintf( stdout, "\t@sh_cmd_parse(): strdup for $cmd->args[0] failed: %s\n", strerror( errno ) );
+}
+/*
+ * Get arena's current position
+ */
+sh_mark_t sh_arena_mark ( const sh_arena_t *arena ) {
 
-        // Free resources
-        free( raw );
+    // Vars
+    sh_mark_t mark;
 
-        // Exit reporting failure
-        return;
+    mark.chunk = arena->cur;
+    mark.used = NULL != arena->cur ? arena->cur->used : 0;
 
-    }
+    return mark;
 
-    i = 1;  // i starts from 1, since the first argument is the command itself
-    while ( ( arg = strsep( &raw, CMD_DEL ) ) != NULL ) {
+}
+/*
+ * Free everything allocated after $mark was taken
+ */
+void sh_arena_release ( sh_arena_t *arena, sh_mark_t mark ) {
 
-        /*
-         * FIX: empty argument
-         * When for any reason an empty arg arrives, ignore it
-         */
-        if ( '<' != *arg && '>' != *arg && sh_strlen( arg ) == 0 ) continue;
+    // Vars
+    sh_chunk_t *chunk, **link;
+    size_t kept;
 
-        /*
-         * FIX: string argument
-         * If the arg is a string then strsep() will split it in spaces.
-         * So, if a string delimiter is detected at the beginning, all args are concatenated until an arg that ends
-         * with the same string delimiter is found.
-         */
-        if ( *arg == '"' || *arg == '\'' ) {
+    // Back to mark ( unless the mark is arena's beginning )
+    if ( NULL != mark.chunk && !( mark.chunk == arena->head && 0 == mark.used ) ) {
 
-            // Vars
-            char str_del;
-            char arg_str[ROW_LEN_MAX] = "";
+        arena->cur = mark.chunk;
+        mark.chunk->used = mark.used;
+        return;
 
-            // Init
-            str_del = *arg;
+    }
 
-            // Begin concatenating arguments
-            do {
-                strcat( arg_str, arg );
-                strcat( arg_str, " " );   // add missing space delimiter
+    // Arena is empty: keep chunks up to ARENA_KEEP_LEN for reuse, return the rest to the system
+    kept = 0;
+    for ( link = &arena->head; NULL != ( chunk = *link ); ) {
 
-                // Check last char
-                if ( str_del == *( arg + strlen( arg ) - 1 ) ) break;
+        kept += chunk->size;
+        if ( kept <= ARENA_KEEP_LEN ) {
 
-                // Get new arg
-            } while ( NULL != ( arg = strsep( &raw, CMD_DEL ) ) );
+            chunk->used = 0;
+            link = &chunk->next;
 
-            // FIX: if not exited loop from break
-            if ( NULL == arg && str_del != *( arg_str + strlen( arg_str ) - 1 ) ) {
+        } else {
 
-                *( arg_str + strlen( arg_str ) ) = str_del;
-                *( arg_str + strlen( arg_str ) + 1 ) = '\0';
+            *link = chunk->next;
+            free( chunk );
 
-            }
+        }
 
-            // Save arg
-            *( cmd->args + i++ ) = strndup( arg_str + 1, strlen( arg_str ) - 3 );
+    }
 
-        } else {
+    arena->cur = arena->head;
 
-            // Save arg ( strdup() will allocate memory for us )
-            *( cmd->args + i ) = strdup( arg );
-            if ( NULL == *( cmd->args + i ) ) {
+}
+/*
+ * Return all arena's chunks to the system
+ */
+void sh_arena_free ( sh_arena_t *arena ) {
 
-                // Report error
-                fprintf( stdout, "\t@sh_cmd_parse(): strdup for $cmd->args[%zu] failed: %s\n", i, strerror( errno ) );
+    // Vars
+    sh_chunk_t *next;
 
-                // Break out of loop
-                break;
+    for ( ; NULL != arena->head; arena->head = next ) {
+        next = arena->head->next;
+        free( arena->head );
+    }
+    arena->cur = NULL;
 
-            }
+}
+/*
+ * -----------
+ * Plan cache
+ * -----------
+ *
+ * Batch files and loops run the same rows over and over. The plan cache keeps the most recently used rows fully
+ * parsed ( scan, commands with their built-ins resolved, arguments and plan ), keyed by the trimmed row, so that a
+ * repeated row skips scanning and parsing and goes straight to execution.
+ *
+ * Each entry is a single block holding an image of the row. Entries are never executed in place: execution edits
+ * commands ( e.g. redirections are purged from the arguments ), so a hit copies the image to $SH_ARENA first, which
+ * is one memcpy() and a pointer fix-up. Parsing depends only on the row's text, so entries are never stale; the
+ * cache is only flushed when $SH_PLAN_CACHE changes.
+ *
+ */
+/*
+ * FNV-1a hash of a slice, 8 bytes per step
+ */
+static size_t sh_plan_hash ( const char *str, size_t len ) {
 
-            // Increment i
-            i++;
+    // Vars
+    size_t hash;
+    uint64_t word;
 
-        }
+    // Init
+    hash = 14695981039346656037UL ^ len;
 
+    // Hash word-by-word, then the tail byte-by-byte
+    for ( ; len >= sizeof( uint64_t ); str += sizeof( uint64_t ), len -= sizeof( uint64_t ) ) {
+        memcpy( &word, str, sizeof( uint64_t ) );
+        hash = ( hash ^ word ) * 1099511628211UL;
+        hash ^= hash >> 32;
+    }
+    while ( len-- > 0 ) {
+        hash ^= ( unsigned char ) *str++;
+        hash *= 1099511628211UL;
     }
 
-    // Last arg should be null-termination for compatibility with execvp()
-    *( cmd->args + i++ ) = ( char * ) 0;  // ARGS_END
+    return hash;
 
-    // Assign args' length
-    cmd->nargs = i;
+}
+/*
+ * Size of the image of a parsed row ( see sh_plan_copy() )
+ */
+static size_t sh_plan_size ( const sh_row_t *row ) {
 
-    // FIX: Delete unused memory
-    // Free unused args ( from arg[cmd->nargs] up to arg[nargs -1] )
-    for ( i = cmd->nargs; i < nargs; ++i ) free( *( cmd->args + i ) );
+    // Vars
+    size_t len;
 
-    //
-    // Check if command is a built-in command
-    // Also, assign the sh_bltcmd_t command to $cmd->bltcmd
-    // The struct sh_bltcmd_t defines two fields: the command name and a function
-    {
-        // Search for built-in command
+    // Init
+    len = strlen( row->raw );
 
-        // Vars
-        size_t nbcmds;
+    return row->scan.ntoks * sizeof( sh_tok_t ) + row->ncmds * sizeof( sh_scmd_t ) +
+           row->nnodes * sizeof( sh_node_t ) + row->ncmds * sizeof( sh_cmd_t ) +
+           ( row->scan.ntoks + row->ncmds ) * sizeof( char * ) + 2 * ( len + 1 );
 
-        // Init
-        nbcmds = sizeof( SH_BUILTIN_CMDS ) / sizeof( *SH_BUILTIN_CMDS );
+}
+/*
+ * Copy a parsed row to $blk ( sh_plan_size() bytes ), as a self-contained image
+ *
+ * Image's layout: tokens, scanned commands, plan nodes, then the commands / argv arrays / arguments block, as
+ * allocated by sh_row_parse(), and the raw row last. Pointers into the commands block are rebased.
+ *
+ * @param dst [sh_row_t]: The row object that will describe the image
+ * @param src [sh_row_t]: The parsed row ( in $SH_ARENA or an image )
+ * @param blk [string]: The memory of the image
+ */
+static void sh_plan_copy ( sh_row_t *dst, const sh_row_t *src, char *blk ) {
 
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-            fprintf( stdout, "\t@sh_cmd_parse(): # of built-in commands: %zu\n", nbcmds );
+    // Vars
+    size_t len, nargv, i;
+    char **sargv, **dargv, *sbuf, *dbuf;
 
-        // Loop through array
-        for ( i = 0; i < nbcmds; ++i )
-            if ( strcmp( ( SH_BUILTIN_CMDS + i )->cmd, cmd->cmd ) == 0 ) {
+    // Init
+    len = strlen( src->raw );
+    nargv = src->scan.ntoks + src->ncmds;
+    sargv = ( char ** ) ( src->cmds + src->ncmds );
+    sbuf = ( char * ) ( sargv + nargv );
+    *dst = *src;
+
+    // Copy scan and plan ( offsets only )
+    dst->scan.toks = ( sh_tok_t * ) blk;
+    memcpy( blk, src->scan.toks, src->scan.ntoks * sizeof( sh_tok_t ) );
+    blk += src->scan.ntoks * sizeof( sh_tok_t );
+
+    dst->scan.cmds = ( sh_scmd_t * ) blk;
+    memcpy( blk, src->scan.cmds, src->ncmds * sizeof( sh_scmd_t ) );
+    blk += src->ncmds * sizeof( sh_scmd_t );
+
+    dst->plan = ( sh_node_t * ) blk;
+    memcpy( blk, src->plan, src->nnodes * sizeof( sh_node_t ) );
+    blk += src->nnodes * sizeof( sh_node_t );
+
+    // Copy commands, argv arrays and arguments
+    dst->cmds = ( sh_cmd_t * ) blk;
+    memcpy( blk, src->cmds, src->ncmds * sizeof( sh_cmd_t ) + nargv * sizeof( char * ) + len + 1 );
+    blk += src->ncmds * sizeof( sh_cmd_t ) + nargv * sizeof( char * ) + len + 1;
+
+    // Rebase pointers
+    dargv = ( char ** ) ( dst->cmds + dst->ncmds );
+    dbuf = ( char * ) ( dargv + nargv );
+    for ( i = 0; i < nargv; ++i )
+        if ( NULL != *( dargv + i ) ) *( dargv + i ) = dbuf + ( *( sargv + i ) - sbuf );
+    for ( i = 0; i < dst->ncmds; ++i ) {
+        ( dst->cmds + i )->args = dargv + ( ( src->cmds + i )->args - sargv );
+        ( dst->cmds + i )->cmd = dbuf + ( ( src->cmds + i )->cmd - sbuf );
+    }
 
-                // DEBUGGING:
-                if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-                    fprintf( stdout, "\t@sh_cmd_parse(): IS a built-in command ( '%s' )\n", cmd->cmd );
+    // Copy raw row
+    dst->raw = blk;
+    memcpy( blk, src->raw, len + 1 );
 
-                // Command found
-                cmd->is_blt = true;
-                cmd->bltcmd = SH_BUILTIN_CMDS + i;
+}
+/*
+ * Unlink an entry from the recently used list
+ */
+static void sh_plan_unlink ( sh_planent_t *ent ) {
 
-                // Break out of loop
-                break;
+    if ( NULL != ent->prev ) ent->prev->next = ent->next;
+    else SH_PLAN_CACHE.head = ent->next;
+    if ( NULL != ent->next ) ent->next->prev = ent->prev;
+    else SH_PLAN_CACHE.tail = ent->prev;
 
-            }
+}
+/*
+ * Link an entry as the most recently used
+ */
+static void sh_plan_push ( sh_planent_t *ent ) {
 
-        // If reaches here with i == nbcmds, no match found
-        if ( i == nbcmds ) {
+    ent->prev = NULL;
+    ent->next = SH_PLAN_CACHE.head;
+    if ( NULL != ent->next ) ent->next->prev = ent;
+    else SH_PLAN_CACHE.tail = ent;
+    SH_PLAN_CACHE.head = ent;
 
-            // DEBUGGING:
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-                fprintf( stdout, "\t@sh_cmd_parse(): NOT a built-in command\n" );
+}
+/*
+ * Find a trimmed row in the cache ( and mark it as the most recently used )
+ *
+ * @param str [string]: The trimmed row ( not NULL-terminated )
+ * @param len [size_t]: Length of $str
+ * @param hash [size_t]: sh_plan_hash() of $str
+ * @return [sh_planent_t *]: The entry or NULL if row is not cached. The entry is owned by the cache.
+ */
+sh_planent_t *sh_plan_lookup ( const char *str, size_t len, size_t hash ) {
 
-            // No match found
-            cmd->is_blt = false;
-            cmd->bltcmd = NULL;
+    // Vars
+    sh_planent_t *ent;
 
-        }
+    // Cache is disabled
+    if ( SH_CONF.plan_cache <= 0 ) return NULL;
 
-    }
+    // Search bucket
+    ent = NULL;
+    if ( NULL != SH_PLAN_CACHE.buckets && ( size_t ) SH_CONF.plan_cache == SH_PLAN_CACHE.cap )
+        for ( ent = *( SH_PLAN_CACHE.buckets + ( hash & ( SH_PLAN_CACHE.nbuckets - 1 ) ) ); NULL != ent;
+              ent = ent->chain )
+            if ( ent->hash == hash && ent->len == len && memcmp( ent->row.raw, str, len ) == 0 ) break;
 
-    // Free resources
-    free( raw );
-    free( arg );
+    // Miss
+    if ( NULL == ent ) {
 
-    // Inform state
-    cmd->is_prs = true;
+        SH_PLAN_CACHE.misses++;
 
-}
-void sh_cmd_inspect ( sh_cmd_t *cmd ) {
+        // DEBUGGING:
+        if ( SH_DBG( 2 ) )
+            fprintf( stdout, "\t@sh_plan_lookup(): miss ( %zu hits / %zu misses )\n", SH_PLAN_CACHE.hits,
+                     SH_PLAN_CACHE.misses );
 
-    // Opening text
-    fprintf( stdout, "\t@sh_cmd_inspect(): command inspection start\n" );
-
-    // Echo command and data
-    fprintf( stdout, "\t\t--%s--\n\t\t\tempty: %s\n\t\t\tvalid: %s\n", cmd->cmd,
-             cmd->utils->isempty( cmd ) ? "YES" : "NO", cmd->utils->isvalid( cmd ) ? "YES" : "NO" );
-
-    // Echo Args
-    fprintf( stdout, "\t\t-args ( %zu ):\n", cmd->nargs );
-    for ( size_t j = 0; j < cmd->nargs; j++ )
-        fprintf( stdout, "\t\t\targ[%zu]: %s\n", j, *( cmd->args + j ) );
+        return NULL;
 
-    // Echo glues
-    fprintf( stdout, "\t\t-glues:\n" );
-    fprintf( stdout, "\t\t\tbef: '%s'\n", cmd->glue_b );
-    fprintf( stdout, "\t\t\taft: '%s'\n", cmd->glue_a );
+    }
 
-    // Echo props
-    fprintf( stdout, "\t\t-props:\n" );
-    fprintf( stdout, "\t\t\tparsed: '%s'\n", cmd->is_prs ? "YES" : "NO" );
-    fprintf( stdout, "\t\t\tis_blt: '%s'\n", cmd->is_blt ? "YES" : "NO" );
+    // Hit
+    SH_PLAN_CACHE.hits++;
+    if ( SH_PLAN_CACHE.head != ent ) {
+        sh_plan_unlink( ent );
+        sh_plan_push( ent );
+    }
 
-    // Echo associated built-in command's name
-    fprintf( stdout, "\t\t-blt:\n" );
-    fprintf( stdout, "\t\t\tbltcmd: '%s'\n", cmd->is_blt ? cmd->bltcmd->cmd : "(null)" );
+    // DEBUGGING:
+    if ( SH_DBG( 2 ) )
+        fprintf( stdout, "\t@sh_plan_lookup(): hit ( %zu hits / %zu misses )\n", SH_PLAN_CACHE.hits,
+                 SH_PLAN_CACHE.misses );
 
-    // Closing text
-    fprintf( stdout, "\t@sh_cmd_inspect(): command inspection stop\n" );
+    return ent;
 
 }
-
 /*
- * ------------------
- * Shell Row methods
- * ------------------
+ * Insert a parsed row in the cache, evicting the least recently used entry if the cache is full
  *
+ * Row's commands should have been parsed ( built-ins resolved ) and not executed yet.
+ *
+ * @param row [sh_row_t]: The parsed row ( it is copied )
+ * @param hash [size_t]: sh_plan_hash() of $row->raw
  */
-/*
- * Trim whole row
- */
-void sh_row_trim ( sh_row_t *row ) {
+void sh_plan_insert ( const sh_row_t *row, size_t hash ) {
 
     // Vars
-    char dest[strlen( row->raw )], *orig;
-    size_t i, left, right, len;
+    sh_planent_t *ent, **link;
 
-    // Init
-    i = 0;
-    left = 0;
-    orig = row->raw;
+    // Resize ( or disable ) the cache if $SH_PLAN_CACHE changed
+    if ( NULL != SH_PLAN_CACHE.buckets && ( size_t ) SH_CONF.plan_cache != SH_PLAN_CACHE.cap ) sh_plan_flush();
+    if ( SH_CONF.plan_cache <= 0 || NULL == row->plan ) return;
+
+    // Allocate buckets ( load factor at most 1/2 )
+    if ( NULL == SH_PLAN_CACHE.buckets ) {
 
-    // Replace multiple spaces with single space
-    // While we're not at the end of the string, loop...
-    while ( *row->raw != '\0' ) {
+        SH_PLAN_CACHE.cap = ( size_t ) SH_CONF.plan_cache;
+        for ( SH_PLAN_CACHE.nbuckets = 1; SH_PLAN_CACHE.nbuckets < 2 * SH_PLAN_CACHE.cap; )
+            SH_PLAN_CACHE.nbuckets <<= 1;
+        SH_PLAN_CACHE.buckets = ( sh_planent_t ** ) calloc( SH_PLAN_CACHE.nbuckets, sizeof( sh_planent_t * ) );
+        if ( NULL == SH_PLAN_CACHE.buckets ) {
 
-        // Remove double spaces
-        // Loop while the current character is a space, and the next
-        // character is a space
-        while ( *row->raw == ' ' && *( row->raw + 1 ) == ' ' ) row->raw++; // skip to next character
+            // Report error
+            fprintf( stdout, "\t@sh_plan_insert(): calloc for $buckets failed: %s\n", strerror( errno ) );
+
+            // Return failure ( row is just not cached )
+            return;
 
-        // Copy from the "source" string to the "destination" string,
-        // while advancing to the next character in both
-        *( dest + i++ ) = *row->raw++;
+        }
 
     }
-    *( dest + i ) = '\0';
 
-    // Init vars
-    len = strlen( dest );
-    right = len;
+    // Evict least recently used entry
+    if ( SH_PLAN_CACHE.nused == SH_PLAN_CACHE.cap ) {
 
-    // Trim leading non alphanumerics
-    i = 0;
-    while ( isspace( *( dest + i++ ) ) && left++ );
+        ent = SH_PLAN_CACHE.tail;
+        sh_plan_unlink( ent );
+        for ( link = SH_PLAN_CACHE.buckets + ( ent->hash & ( SH_PLAN_CACHE.nbuckets - 1 ) ); *link != ent; )
+            link = &( *link )->chain;
+        *link = ent->chain;
+        free( ent );
+        SH_PLAN_CACHE.nused--;
 
-    // Trim trailing non alphanumerics
-    i = 1;
-    while ( isspace( *( dest + len - i++ ) ) && right > 0 && right-- );
+    }
 
-    // FIX: empty string of non-alphanumerics
-    if ( right < left ) right = left;
+    // Create entry
+    ent = ( sh_planent_t * ) malloc( sizeof( sh_planent_t ) + sh_plan_size( row ) );
+    if ( NULL == ent ) {
 
-    // Reallocate $cmd->cmd to prevent memory leaks
-    row->raw = ( char * ) realloc( orig, right - left + 1 );
+        // Report error
+        fprintf( stdout, "\t@sh_plan_insert(): malloc for $ent failed: %s\n", strerror( errno ) );
 
-    // Copy part of initial command string to $trimmed
-    memmove( ( void * ) row->raw, ( void * ) dest + left, ( right - left ) );
-    *( row->raw + right - left ) = '\0';
+        // Return failure ( row is just not cached )
+        return;
 
-    // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-        fprintf( stdout, "\t@trim(): row after sh_row_trim: --%s--\n", row->raw );
+    }
+    sh_plan_copy( &ent->row, row, ( char * ) ( ent + 1 ) );
+    ent->hash = hash;
+    ent->len = strlen( row->raw );
+
+    // Link entry
+    link = SH_PLAN_CACHE.buckets + ( hash & ( SH_PLAN_CACHE.nbuckets - 1 ) );
+    ent->chain = *link;
+    *link = ent;
+    sh_plan_push( ent );
+    SH_PLAN_CACHE.nused++;
 
-}
-bool sh_row_iscomment ( sh_row_t *row ) {
-    return *row->raw == '#';
 }
 /*
- * Parse row
- * Extract commands and the way commands are joined to each other, forming a shell_row_t object
+ * Drop every cached row ( hit / miss counters are kept )
  */
-void sh_row_parse ( sh_row_t *row ) {
+void sh_plan_flush ( void ) {
 
     // Vars
-    char *raw, *raworig, *tmp, *tester;
-    size_t sample_len, test_len, del_size, j, ncmds, i, i_real, untrimmed_len;
-
-    // Init
-    test_len = 3;                           // max str len of delimiter
-    untrimmed_len = 0;                      // To be used when finding delimiter
-    ncmds = sh_ntokens( row->raw, ROW_DEL );// # of commands included in row
-
-    // Allocate commands' memory
-    row->cmds = ( sh_cmd_t * ) malloc( ncmds * sizeof( sh_cmd_t ) );
-    if ( NULL == row->cmds ) {
+    sh_planent_t *ent, *next;
 
-        // Echo error
-        fprintf( stdout, "\t@parse(): malloc for $row->cmds failed: %s\n", strerror( errno ) );
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_plan_flush(): flushing %zu entries ( %zu hits / %zu misses )\n",
+                 SH_PLAN_CACHE.nused, SH_PLAN_CACHE.hits, SH_PLAN_CACHE.misses );
+
+    // Free entries
+    for ( ent = SH_PLAN_CACHE.head; NULL != ent; ent = next ) {
+        next = ent->next;
+        free( ent );
+    }
+    free( SH_PLAN_CACHE.buckets );
 
-        // FIX: set $row->ncmds to 0
-        row->ncmds = 0;
+    // Reset
+    SH_PLAN_CACHE.cap = SH_PLAN_CACHE.nused = SH_PLAN_CACHE.nbuckets = 0;
+    SH_PLAN_CACHE.buckets = NULL;
+    SH_PLAN_CACHE.head = SH_PLAN_CACHE.tail = NULL;
 
-        // Return failure
-        return;
+}
+/*
+ * ------------
+ * Row scanner
+ * ------------
+ *
+ * A row is tokenized in a single pass. Each block of SH_SCAN_W bytes is reduced to a bitmask of its special bytes
+ * ( ROW_DEL, CMD_DEL and STR_DEL ) with vector compares ( AVX2 / SSE2, or the class table where neither exists ).
+ * Only the special bytes are then visited, in order, by a small state machine; runs of plain bytes between them are
+ * never touched. The sweep emits the slice of every command, the operator that ends it and the slices of its
+ * arguments ( quotes stripped ), all as offsets into the scanned string.
+ *
+ * Inside quotes every delimiter is a plain byte. A quote only opens a string at the beginning of an argument.
+ *
+ */
+/*
+ * Fill the byte class table from the delimiter sets
+ */
+void sh_scan_init ( void ) {
 
-    }
+    // Vars
+    const char *c;
 
-    // Get part after $tmp to check for the delimiter
-    tester = ( char * ) calloc( test_len, sizeof( char ) );
-    if ( NULL == tester ) {
+    memset( SH_SCAN_CLS, SH_CLS_NONE, sizeof( SH_SCAN_CLS ) );
+    for ( c = CMD_DEL; *c; ++c ) SH_SCAN_CLS[ ( unsigned char ) *c ] = SH_CLS_CMD;
+    for ( c = ROW_DEL; *c; ++c ) SH_SCAN_CLS[ ( unsigned char ) *c ] = SH_CLS_ROW;
+    for ( c = STR_DEL; *c; ++c ) SH_SCAN_CLS[ ( unsigned char ) *c ] = SH_CLS_QUOTE;
 
-        // Echo error
-        fprintf( stdout, "\t@parse(): calloc for $tester failed: %s\n", strerror( errno ) );
+}
+/*
+ * Scan $len bytes of $str to commands and arguments
+ *
+ * @param arena [sh_arena_t]: Where the result's arrays are allocated
+ * @param scan [sh_scan_t]: The result
+ * @return [bool]: FALSE if allocation failed
+ */
+bool sh_scan ( sh_arena_t *arena, const char *str, size_t len, sh_scan_t *scan ) {
 
-        // Break out of loop
-        return;
+    // Vars
+    char tail[SH_SCAN_W], quote;
+    const char *blk;
+    size_t cap, base, p, prev, tok, qbeg, ctok, cbeg, cend, rlen;
+    uint32_t mask;
+    sh_op_t op;
+    unsigned char c;
+    bool skip;
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+    sh_vec_t vsp[16], v, m;
+    size_t nsp, i;
+    const char *sp;
+
+    // Broadcast every special byte
+    nsp = 0;
+    for ( sp = CMD_DEL; *sp; ++sp ) vsp[ nsp++ ] = sh_vec_set1( *sp );
+    for ( sp = ROW_DEL; *sp; ++sp ) vsp[ nsp++ ] = sh_vec_set1( *sp );
+    for ( sp = STR_DEL; *sp; ++sp ) vsp[ nsp++ ] = sh_vec_set1( *sp );
+#else
+    size_t i;
+#endif
+
+    // Allocate for the worst case: one argument every two bytes ( e.g. "a b c" or """""" )
+    cap = len / 2 + 1;
+    scan->ntoks = scan->ncmds = 0;
+    scan->toks = ( sh_tok_t * ) sh_arena_alloc( arena, cap * ( sizeof( sh_tok_t ) + sizeof( sh_scmd_t ) ) );
+    scan->cmds = ( sh_scmd_t * ) ( scan->toks + cap );
+    if ( NULL == scan->toks ) return false;
+
+    // Init state
+    prev = SIZE_MAX;    // last special byte
+    tok = SIZE_MAX;     // first byte of current ( unquoted ) argument
+    qbeg = 0;           // first byte of current quoted argument
+    quote = '\0';       // opening quote of current quoted argument
+    ctok = 0;           // current command's first argument
+    cbeg = cend = 0;    // current command's slice
+    skip = false;       // second byte of "||" or "&&"
+
+    // Sweep, one block at a time ( the end of $str is a special byte of its own )
+    for ( base = 0; base <= len; base += SH_SCAN_W ) {
+
+        // Load block ( the last one is copied to a zero-padded buffer )
+        rlen = len - base;
+        if ( rlen >= SH_SCAN_W ) blk = str + base;
+        else {
+            memset( tail, 0, SH_SCAN_W );
+            memcpy( tail, str + base, rlen );
+            blk = tail;
+        }
 
-    }
+        // Classify block
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+        v = sh_vec_load( blk );
+        m = sh_vec_zero();
+        for ( i = 0; i < nsp; ++i ) m = sh_vec_or( m, sh_vec_eq( v, vsp[ i ] ) );
+        mask = sh_vec_mask( m );
+#else
+        for ( mask = 0, i = 0; i < SH_SCAN_W; ++i )
+            if ( SH_SCAN_CLS[ ( unsigned char ) blk[ i ] ] ) mask |= ( uint32_t ) 1 << i;
+#endif
+        if ( rlen < SH_SCAN_W ) mask = ( mask & ( ( ( uint32_t ) 1 << rlen ) - 1 ) ) | ( uint32_t ) 1 << rlen;
+
+        // Visit special bytes
+        for ( ; 0 != mask; mask &= mask - 1 ) {
 
-    // Backup raw
-    raw = ( char * ) malloc( strlen( row->raw ) + 1 );
-    if ( NULL == raw || NULL == strcpy( raw, row->raw ) ) {
+            // Init
+            p = base + __builtin_ctz( mask );
+            c = p < len ? SH_SCAN_CLS[ ( unsigned char ) str[ p ] ] : SH_CLS_END;
 
-        // Report error
-        fprintf( stdout, "\t@parse(): malloc / strcpy for $raw failed: %s\n", strerror( errno ) );
+            // A run of plain bytes before $p starts an argument
+            if ( '\0' == quote && SIZE_MAX == tok && p != prev + 1 ) tok = prev + 1;
+            prev = p;
 
-        // Free resources
-        free( row->raw );
+            // Second byte of an operator
+            if ( skip ) {
+                skip = false;
+                continue;
+            }
 
-        // FIX: set $row->ncmds to 0
-        row->ncmds = 0;
+            // Inside quotes only the closing quote ( or the end ) matters
+            if ( '\0' != quote ) {
 
-        // Exit reporting failure
-        return;
+                if ( SH_CLS_END != c && quote != str[ p ] ) continue;
 
-    }
-    raworig = raw;
+                // Emit quoted argument
+                if ( scan->ntoks == ctok ) cbeg = qbeg - 1;
+                ( scan->toks + scan->ntoks )->off = qbeg;
+                ( scan->toks + scan->ntoks++ )->len = p - qbeg;
+                cend = p < len ? p + 1 : p;
+                quote = '\0';
 
-    // Get Commands
-    for ( i = 0, i_real = 0; i < ncmds; ++i ) {
+                if ( SH_CLS_END != c ) continue;
 
-        // Get command
-        tmp = strsep( &raw, ROW_DEL );
-        if ( NULL == tmp ) {
+            }
 
-            // Report error
-            fprintf( stdout, "\t@parse(): strsep for $tmp failed: %s\n", strerror( errno ) );
+            // A quote at the beginning of an argument opens a string, elsewhere it is a plain byte
+            if ( SH_CLS_QUOTE == c ) {
 
-            // Break out of loop
-            break;
+                if ( SIZE_MAX == tok ) {
+                    quote = str[ p ];
+                    qbeg = p + 1;
+                }
+                continue;
 
-        }
+            }
 
-        // FIX: check if tmp is empty (or has spaces)
-        if ( sh_strlen( tmp ) == 0 ) continue;
+            // Any other special byte ends current argument
+            if ( SIZE_MAX != tok ) {
 
-        // Single command init
-        ( row->cmds + i_real )->cmd = ( char * ) malloc( strlen( tmp ) + 1 );
-        if ( NULL == ( row->cmds + i_real )->cmd || NULL == strcpy( ( row->cmds + i_real )->cmd, tmp ) ) {
+                if ( scan->ntoks == ctok ) cbeg = tok;
+                ( scan->toks + scan->ntoks )->off = tok;
+                ( scan->toks + scan->ntoks++ )->len = p - tok;
+                cend = p;
+                tok = SIZE_MAX;
 
-            // Report error
-            fprintf( stdout, "\t@parse(): malloc / strcpy for $row->cmds[%zu].cmd failed: %s\n", i_real, strerror( errno ) );
+            }
+            if ( SH_CLS_CMD == c ) continue;
 
-            // Break out of loop
-            break;
+            // Operator ( or the end ) ends current command
+            op = SH_OP_NONE;
+            if ( SH_CLS_ROW == c ) {
 
-        }
+                skip = p + 1 < len && str[ p + 1 ] == str[ p ] && ';' != str[ p ];
+                op = '|' == str[ p ] ? ( skip ? SH_OP_OR : SH_OP_PIPE ) :
+                     '&' == str[ p ] ? ( skip ? SH_OP_AND : SH_OP_BG ) : SH_OP_SEQ;
 
-        // Set utils
-        ( row->cmds + i_real )->utils = cmdutils;
+            }
 
-        // Set glues
-        // 1 ) Before
-        ( row->cmds + i_real )->glue_b = i_real == 0 ? "" : ( row->cmds + i_real - 1 )->glue_a;
-        // 2 ) After
-        ( row->cmds + i_real )->glue_a = ""; // Default value
-        if ( i < ncmds - 1 ) {
+            // Empty commands are dropped ( the previous one keeps its operator )
+            if ( scan->ntoks > ctok ) {
 
-            // Init
-            untrimmed_len += strlen( tmp );
-            del_size = sizeof( DEL_ARR ) / sizeof( *DEL_ARR );
+                ( scan->cmds + scan->ncmds )->off = cbeg;
+                ( scan->cmds + scan->ncmds )->len = cend - cbeg;
+                ( scan->cmds + scan->ncmds )->tok = ctok;
+                ( scan->cmds + scan->ncmds )->ntoks = scan->ntoks - ctok;
+                ( scan->cmds + scan->ncmds++ )->op = op;
+                ctok = scan->ntoks;
 
-            sprintf( tester, "%.*s", ( int ) test_len, row->raw + untrimmed_len );
+            }
 
-            // Check with all delimiters until one found
-            for ( j = 0; j < del_size; ++j ) {
+        }
 
-                // Get sample's length
-                sample_len = strlen( *( DEL_ARR + j ) );
+    }
 
-                // Test the part after string with sample
-                if ( !strncmp( *( DEL_ARR + j ), tester, sample_len ) ) {
+    return true;
 
-                    // Assign value
-                    ( row->cmds + i_real )->glue_a = strdup( *( DEL_ARR + j ) );
-                    if ( NULL == ( row->cmds + i_real )->glue_a ) {
+}
 
-                        // Report error
-                        fprintf( stdout, "\t@parse(): strdup for $row->cmds[%zu].glue_a failed: %s\n", i_real,
-                                 strerror( errno ) );
+/*
+ * -----------
+ * Row reader
+ * -----------
+ *
+ * Rows are handed out as slices ( not NULL-terminated ) of the reader's buffer, so they have no maximum length and
+ * are never copied.
+ *  - regular files are mapped with mmap(): the buffer is the whole file, pages are read ahead and dropped behind
+ *    by the kernel, so even huge files cost no extra memory
+ *  - anything else ( pipes, terminals, ... ) is read() in blocks of RD_BLK_LEN bytes; a row that does not fit in
+ *    the buffer makes it grow
+ *
+ */
+/*
+ * @param fd [int]: The input's descriptor ( it is not closed by the reader )
+ * @param map [bool]: Map $fd if it is a regular file
+ * @return [bool]: FALSE if the buffer could not be allocated, TRUE otherwise
+ */
+bool sh_reader_init ( sh_reader_t *rd, int fd, bool map ) {
 
-                        // Break out of loop
-                        break;
+    // Vars
+    struct stat st;
+    void *addr;
 
-                    }
+    // Init
+    memset( rd, 0, sizeof( sh_reader_t ) );
+    rd->fd = fd;
 
-                    // Update $untrimmed_len
-                    untrimmed_len += strlen( *( DEL_ARR + j ) );
+    // Map regular files ( empty files cannot be mapped, they are just read )
+    if ( map && fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 ) {
 
-                    // Finish searching
-                    break;
+        addr = mmap( NULL, ( size_t ) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( MAP_FAILED != addr ) {
 
-                }
-            }
+            // The whole input is already in the buffer
+            madvise( addr, ( size_t ) st.st_size, MADV_SEQUENTIAL );
+            rd->buf = ( char * ) addr;
+            rd->cap = rd->end = ( size_t ) st.st_size;
+            rd->eof = rd->map = true;
+            return true;
 
-            // If reaches here ( not from brake ), no delimiter found, the default is will be used
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 ) {
+        }
 
-                if ( j == del_size )
-                    fprintf( stdout, "\t@parse(): ERROR, no delimiter found\n" );
-                else
-                    fprintf( stdout, "\t@parse(): delimiter found: '%s'\n", ( row->cmds + i_real )->glue_a );
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_reader_init(): mmap failed, reading instead: %s\n", strerror( errno ) );
 
-            }
+    }
 
-        }
+    rd->cap = RD_BLK_LEN;
+    rd->buf = ( char * ) malloc( rd->cap );
+    if ( NULL == rd->buf ) {
 
-        // Single command parsing: trim
-        ( row->cmds + i_real )->utils->trim( row->cmds + i_real );
+        // Echo error
+        fprintf( stdout, "\t@sh_reader_init(): malloc for $buf failed: %s\n", strerror( errno ) );
 
-        // Increment real i
-        i_real++;
+        // Return failure
+        return false;
 
     }
 
-    // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, "\t@parse(): %zu commands parsed\n", i_real );
+    return true;
 
-    // Assign total nb
-    row->ncmds = i_real;
+}
+/*
+ * Get next row
+ *
+ * @param len [size_t]: Set to row's length ( <lf> excluded )
+ * @return [string]: The row ( not NULL-terminated, valid until next call ) or NULL at the end of input
+ */
+const char *sh_reader_next ( sh_reader_t *rd, size_t *len ) {
 
-    // Free resources
-    free( raworig );
-    free( tester );
+    // Vars
+    const char *row, *lf;
+    char *buf;
+    ssize_t n;
 
-}
-void sh_row_inspect ( sh_row_t *row ) {
+    for ( ;; ) {
 
-    // Opening text
-    fprintf( stdout, "\t@inspect(): row inspection start\n" );
+        // Complete row in buffer
+        lf = ( const char * ) memchr( rd->buf + rd->pos, '\n', rd->end - rd->pos );
+        if ( NULL != lf ) {
 
-    // Inspect commands
-    for ( size_t i = 0; i < row->ncmds; i++ ) {
+            row = rd->buf + rd->beg;
+            *len = ( size_t ) ( lf - row );
+            rd->beg = rd->pos = ( size_t ) ( lf - rd->buf ) + 1;
+            return row;
 
-        // Before parsing
-        fprintf( stdout, "\tRAW: --%s--\n\tPARSED:\n", ( row->cmds + i )->cmd );
+        }
+        rd->pos = rd->end;
 
-        // Parse
-        ( row->cmds + i )->utils->parse( row->cmds + i );
+        // Last row may not end with <lf>
+        if ( rd->eof ) {
 
-        // Inspect
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            ( row->cmds + i )->utils->inspect( row->cmds + i );
+            if ( rd->beg == rd->end ) return NULL;
+            row = rd->buf + rd->beg;
+            *len = rd->end - rd->beg;
+            rd->beg = rd->pos = rd->end;
+            return row;
 
-    }
+        }
 
-    // Closing text
-    fprintf( stdout, "\t@inspect(): row inspection stop\n" );
+        // Move partial row to buffer's start
+        if ( rd->beg > 0 ) {
+            memmove( rd->buf, rd->buf + rd->beg, rd->end - rd->beg );
+            rd->end -= rd->beg;
+            rd->pos -= rd->beg;
+            rd->beg = 0;
+        }
 
-}
-bool sh_row_exec ( sh_row_t *row ) {
+        // Grow if the partial row fills the buffer
+        if ( rd->end == rd->cap ) {
 
-    // Print formal params
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, "\t@exec(): executing row's commands ( raw: --%s-- )\n", row->raw );
+            buf = ( char * ) realloc( rd->buf, 2 * rd->cap );
+            if ( NULL == buf ) {
 
-    // Vars
-    size_t from, ncmds, i;
-    bool entered, result_ov;
+                // Echo error
+                fprintf( stdout, "\t@sh_reader_next(): realloc for $buf failed: %s\n", strerror( errno ) );
 
-    // Init
-    from = 0;
-    ncmds = 1;  // FIX
-    entered = false;
-    result_ov = true;
+                // Return failure ( end of input )
+                return NULL;
 
-    /*
-     * Split row execution to command-sets
-     *
-     * Search $row->cmds until an end major-command-set delimiter is found (';' or '&')
-     * Then, execute each major command-set in sh_exec_major_command_set().
-     *
-     */
-    for ( i = 0; i < row->ncmds; ++i, ++ncmds ) {
+            }
+            rd->buf = buf;
+            rd->cap *= 2;
 
-        // Check @row->cmds[i] 's glue_a if it matches any of the major end delimiters
-        // Also, if reached last command, then enter as if last command's glue_a was ';'
-        if ( ';' == *( row->cmds + i )->glue_a || i == row->ncmds - 1 ) {
+        }
 
-            // Command-set end found: ';'
-            result_ov = sh_exec_major_command_set( row, from, ncmds );
+        // Read next block ( serving built-in command requests of background command-sets meanwhile )
+        sh_wait_input( rd->fd );
+        n = read( rd->fd, rd->buf + rd->end, rd->cap - rd->end );
+        if ( n > 0 ) rd->end += ( size_t ) n;
+        else if ( 0 == n ) rd->eof = true;
+        else if ( EINTR != errno ) {
 
-            // Update $entered flag
-            if ( !entered ) entered = true;
+            // Echo error
+            fprintf( stdout, "\t@sh_reader_next(): read failed: %s\n", strerror( errno ) );
 
-            // Reset $from, $ncmds
-            from = i + 1;
-            ncmds = 0;
+            // Treat as end of input ( rows read so far are still returned )
+            rd->eof = true;
 
         }
 
     }
 
-    // Return whole row's execution result
-    // This will be shell's output status
-    return result_ov;
+}
+void sh_reader_free ( sh_reader_t *rd ) {
+
+    if ( rd->map ) munmap( rd->buf, rd->cap );
+    else free( rd->buf );
+    rd->buf = NULL;
 
 }
 
@@ -848,40 +1181,10 @@ size_t sh_ntokens ( const char *haystack, const char *del ) {
     return nargs;
 
 }
-bool sh_quit ( const char *raw ) {
-
-    // Vars
-    char *tmp, *quit;
-    bool equals;
-    int i;
-
-    // Init
-    tmp = ( char * ) calloc( strlen( raw ), sizeof( char ) );
-    if ( NULL == tmp ) {
-
-        // Echo error
-        fprintf( stdout, "\t@sh_quit(): calloc for $quit failed: %s\n", strerror( errno ) );
-
-        // Return failure ( true in order to quit )
-        return true;
-
-    }
-
-    quit = "quit";
-
-    // Copy & cvt string to lower
-    for ( i = 0; *( raw + i ); i++ ) {
-        *( tmp + i ) = ( char ) tolower( *( raw + i ) );
-    }
-
-    // Decide
-    equals = strncmp( tmp, quit, strlen( quit ) ) == 0 ? true : false;
-
-    // Free resources
-    free( tmp );
+bool sh_quit ( const char *raw, size_t len ) {
 
-    // Return
-    return equals;
+    // Case-insensitive prefix match ( no copies, this is checked for every row )
+    return len >= 4 && strncasecmp( raw, "quit", 4 ) == 0;
 
 }
 void sh_cls ( void ) {
@@ -925,7 +1228,8 @@ void sh_inspect_pipes ( int **pc, size_t n ) {
     fprintf( stdout, "\t\t  idx\t|\tread\t|\twrite\n" );
     fprintf( stdout, "\t\t--------|-----------|---------\n" );
     for ( int i = 0; i < n; ++i ) {
-        fprintf( stdout, "\t\t  %03d\t|\t %02d \t|\t %02d\n", i, pc[ i ][ READ_EDGE ], pc[ i ][ WRITE_EDGE ] );
+        if ( NULL == pc[ i ] ) fprintf( stdout, "\t\t  %03d\t|\t -- \t|\t stdout\n", i );
+        else fprintf( stdout, "\t\t  %03d\t|\t %02d \t|\t %02d\n", i, pc[ i ][ READ_EDGE ], pc[ i ][ WRITE_EDGE ] );
     }
     fprintf( stdout, "\t<-------------------------------------->\n" );
 
@@ -969,7 +1273,7 @@ size_t sh_cmd_lt_arg_exists ( sh_cmd_t *cmd ) {
         if ( strncmp( "<", *( cmd->args + i ), 1 ) == 0 ) {
 
             // DEBUGGING:
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
+            if ( SH_DBG( 2 ) )
                 fprintf( stdout, "\t@sh_cmd_lt_arg_exists(): '<' found in arg[ %zu ]\n", i );
 
             return i;
@@ -1001,7 +1305,7 @@ size_t sh_cmd_gt_arg_exists ( sh_cmd_t *cmd ) {
         if ( strncmp( ">", *( cmd->args + i ), 1 ) == 0 ) {
 
             // DEBUGGING:
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
+            if ( SH_DBG( 2 ) )
                 fprintf( stdout, "\t@sh_cmd_gt_arg_exists(): '>' found in arg[ %zu ]\n", i );
 
             return i;
@@ -1025,21 +1329,10 @@ size_t sh_cmd_gt_arg_exists ( sh_cmd_t *cmd ) {
 bool sh_cmd_purge_args( sh_cmd_t *cmd, size_t from, size_t nargs ) {
 
     // Check validity of $from, $nargs
-    if ( from < 1 || from + nargs > cmd->nargs ) return false;
-
-    // Vars
-    size_t i, fi;
+    if ( from < 1 || from + nargs >= cmd->nargs ) return false;
 
-    // Begin freeing mem and replacing pointers
-    for ( i = from, fi = from + nargs; i < from + nargs; ++i, ++fi ) {
-
-        // Free memory
-        free( *( cmd->args + i ) );
-
-        // Update pointers
-        *( cmd->args + i ) = *( cmd->args + fi );
-
-    }
+    // Bring the rest down ( ARGS_END included ), arguments live in the row's buffer so nothing is freed
+    memmove( cmd->args + from, cmd->args + from + nargs, ( cmd->nargs - from - nargs ) * sizeof( char * ) );
 
     // Update nargs of $cmd
     cmd->nargs -= nargs;
@@ -1056,7 +1349,7 @@ bool sh_cmd_purge_args( sh_cmd_t *cmd, size_t from, size_t nargs ) {
 char *sh_file_exists ( const char *raw ) {
 
     // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
+    if ( SH_DBG( 1 ) )
         fprintf( stdout, "\t@sh_file_exists(): searching for file: '%s'\n", raw );
 
     // Vars
@@ -1110,1960 +1403,5219 @@ char *sh_file_exists ( const char *raw ) {
     return NULL;
 
 }
-
-/*
-* ------------------
-* Get env methods
-* ------------------
-*
-*/
 /*
- * Get env var with named after $key
- *
- * Try searching in env, if found sh_cmd_parse value and return. If not found
- * set the default value and return the $def default value
- *
- * @param [string] key: The key to search in getenv()
- * @param [int] def: The default value returned if getenv() fails
- *                   This value is also set in env of $key
+ * Create an anonymous temporary file ( unlinked, closed on exec )
  *
+ * @return [int]: The file's descriptor or -1 on failure
  */
-int sh_get_env ( const char *key, const int def ) {
+int sh_tmpfd ( void ) {
 
     // Vars
-    char *value, *test;
-    int val;
+    char tmpl[] = P_tmpdir "/chshell.XXXXXX";
+    int fd;
 
-    // Get env variable
-    value = getenv( key );
-    if ( NULL == value ) {
+    // Never linked, where supported
+    fd = open( P_tmpdir, O_RDWR | O_TMPFILE | O_CLOEXEC, 0600 );
+    if ( fd >= 0 ) return fd;
 
-        // Error getting env variable
-        // Return default value
-        return def;
+    // Else create and unlink
+    fd = mkostemp( tmpl, O_CLOEXEC );
+    if ( fd >= 0 ) unlink( tmpl );
 
-    }
+    return fd;
 
-    // Parse value to integer
-    val = ( int ) strtol( value, &test, 10 );
-    if ( value == test ) {
+}
 
-        // Strtol failed
-        // Revert to default value
-        return def;
+/*
+ * -----------
+ * PATH index
+ * -----------
+ *
+ * Commands are resolved against $PATH once and the absolute path is kept in an open addressing hash table keyed
+ * by the command's name. Misses are cached too ( with a NULL path ), so an unknown command is not searched again.
+ * The index is flushed whenever $PATH changes or the mtime of any of its directories changes.
+ *
+ */
+/*
+ * FNV-1a hash of a NULL-terminated string
+ */
+static size_t sh_path_hash ( const char *str ) {
+
+    // Vars
+    size_t hash;
 
+    // Hash byte-by-byte
+    hash = 14695981039346656037UL;
+    while ( *str ) {
+        hash ^= ( unsigned char ) *str++;
+        hash *= 1099511628211UL;
     }
 
-    // returned retrieved value
-    return val;
+    return hash;
 
 }
-void sh_set_env ( const char *key, int val ) {
+/*
+ * Find the slot of $cmd in the index ( either the occupied one, or the free one it should be inserted at )
+ */
+static sh_pathent_t *sh_path_slot ( sh_pathent_t *slots, size_t nslots, const char *cmd, size_t hash ) {
 
     // Vars
-    char *valstr;
-
-    // Alloc mem for valstr
-    valstr = ( char * ) calloc( ROW_LEN_MAX, sizeof( char ) );
-    if ( NULL == valstr ) {
+    size_t i;
 
-        // Report error
-        fprintf( stdout, "\t@sh_set_env(): calloc for $valstr failed: %s\n", strerror( errno ) );
+    // Linear probing ( $nslots is a power of 2 and the table is never full )
+    for ( i = hash & ( nslots - 1 ); NULL != ( slots + i )->cmd; i = ( i + 1 ) & ( nslots - 1 ) )
+        if ( ( slots + i )->hash == hash && strcmp( ( slots + i )->cmd, cmd ) == 0 ) break;
 
-        // Return failure
-        return;
+    return slots + i;
 
-    }
+}
+/*
+ * Double the number of slots of the index, re-inserting all entries
+ *
+ * @return [bool]: FALSE if allocation failed ( the index is left untouched ), TRUE otherwise
+ */
+static bool sh_path_grow ( void ) {
 
-    // Convert int $val to string via sprintf
-    if ( 0 > sprintf( valstr, "%d", val ) ) {
+    // Vars
+    sh_pathent_t *slots, *old;
+    size_t nslots, i;
 
-        // sprintf() failed
-        // Report error
-        fprintf( stdout, "\t@sh_set_env(): sprintf failed: %s\n", strerror( errno ) );
+    // Init
+    nslots = 0 == SH_PATH_INDEX.nslots ? PATH_IDX_LEN : SH_PATH_INDEX.nslots << 1;
+    slots = ( sh_pathent_t * ) calloc( nslots, sizeof( sh_pathent_t ) );
+    if ( NULL == slots ) {
 
-        // Free resources
-        free( valstr );
+        // Report error
+        fprintf( stdout, "\t@sh_path_grow(): calloc for $slots failed: %s\n", strerror( errno ) );
 
         // Return failure
-        return;
+        return false;
 
     }
 
-    // Set environment variable
-    if ( -1 == setenv( key, valstr, 1 ) ) {
+    // Re-insert entries
+    for ( i = 0; i < SH_PATH_INDEX.nslots; ++i ) {
 
-        // setenv() failed
-        // Report error
-        fprintf( stdout, "\t@sh_set_env(): setenv failed: %s\n", strerror( errno ) );
+        old = SH_PATH_INDEX.slots + i;
+        if ( NULL != old->cmd ) *sh_path_slot( slots, nslots, old->cmd, old->hash ) = *old;
 
     }
 
-    // Free resources
-    free( valstr );
+    // Swap tables
+    free( SH_PATH_INDEX.slots );
+    SH_PATH_INDEX.slots = slots;
+    SH_PATH_INDEX.nslots = nslots;
 
-}
+    return true;
 
+}
 /*
- * ---------
- * Printers
- * ---------
- *
+ * Drop every resolved command and the directory list the index was built against
  */
-void sh_prt_welcome ( void ) {
+void sh_path_flush ( void ) {
 
-    fprintf( stdout, "\n" );
-    fprintf( stdout, "=================================\n" );
-    fprintf( stdout, "     Welcome to CHShell v%s\n", VERSION );
-    fprintf( stdout, "---------------------------------\n" );
-    fprintf( stdout, "Author: Charisoudis D. Athanasios\n" );
-    fprintf( stdout, "=================================\n" );
-    fprintf( stdout, "\n" );
+    // Vars
+    size_t i;
 
-}
-void sh_prt_bye ( void ) {
+    // DEBUGGING:
+    if ( SH_DBG( 2 ) )
+        fprintf( stdout, "\t@sh_path_flush(): flushing %zu entries\n", SH_PATH_INDEX.nused );
 
-    fprintf( stdout, "\n" );
-    fprintf( stdout, "Thanks for using this shell\n" );
-    fprintf( stdout, "=================================\n" );
-    fprintf( stdout, "          CHShell v%s\n", VERSION );
-    fprintf( stdout, "---------------------------------\n" );
-    fprintf( stdout, "Author: Charisoudis D. Athanasios\n" );
-    fprintf( stdout, "=================================\n" );
-    fprintf( stdout, "\n" );
+    // Free entries
+    for ( i = 0; i < SH_PATH_INDEX.nslots; ++i ) {
 
-}
+        free( ( SH_PATH_INDEX.slots + i )->cmd );
+        free( ( SH_PATH_INDEX.slots + i )->path );
+
+    }
+    free( SH_PATH_INDEX.slots );
+
+    // Free directories ( all point inside $buf )
+    free( SH_PATH_INDEX.buf );
+    free( SH_PATH_INDEX.dirs );
+    free( SH_PATH_INDEX.mtimes );
+    free( SH_PATH_INDEX.env );
+    free( SH_PATH_INDEX.wd );
+
+    // Reset
+    memset( &SH_PATH_INDEX, 0, sizeof( sh_pathidx_t ) );
 
+}
 /*
- * ----------------
- * Signal Handlers
- * ----------------
+ * Make sure the index reflects current $PATH
  *
+ * If $PATH differs from the one the index was built against, or the mtime of any $PATH directory changed ( a
+ * file was added / removed ), or $PATH has relative directories and the working directory changed, the index is
+ * flushed and the directory list is rebuilt. Empty entries stand for the working directory, as in POSIX.
+ * This costs one stat() per $PATH directory and should be called once before a command-set is resolved.
  */
-void sh_SIGCHLD_handler ( int sig ) {
+void sh_path_sync ( void ) {
 
-    // Check signal
-    if ( SIGCHLD != sig ) {
+    // Vars
+    const char *env;
+    char *dirs, *dir;
+    struct stat st;
+    size_t ndirs, i;
+    bool stale;
 
-        // Report error
-        fprintf( stdout, "\t@sh_SIGCHLD_handler(): incorrect signal caught ( caught: %d )\n", sig );
+    // Init
+    env = getenv( "PATH" );
+    if ( NULL == env ) env = "";
 
-        // Return failure
-        return;
+    // Check $PATH itself, then the mtime of its directories
+    stale = NULL == SH_PATH_INDEX.env || strcmp( SH_PATH_INDEX.env, env ) != 0 ||
+            ( NULL != SH_PATH_INDEX.wd && strcmp( SH_PATH_INDEX.wd, SH_WD ) != 0 );
+    for ( i = 0; !stale && i < SH_PATH_INDEX.ndirs; ++i ) {
+
+        if ( stat( *( SH_PATH_INDEX.dirs + i ), &st ) < 0 ) memset( &st, 0, sizeof( struct stat ) );
+        stale = st.st_mtim.tv_sec != ( SH_PATH_INDEX.mtimes + i )->tv_sec ||
+                st.st_mtim.tv_nsec != ( SH_PATH_INDEX.mtimes + i )->tv_nsec;
 
     }
 
-}
-void sh_SIGUSR2_handler ( int sig ) {
+    // Index is up to date
+    if ( !stale ) return;
+
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_path_sync(): PATH index is stale, rebuilding\n" );
 
-    // Check signal
-    if ( SIGUSR2 != sig ) {
+    // Rebuild
+    sh_path_flush();
+
+    SH_PATH_INDEX.env = strdup( env );
+    SH_PATH_INDEX.buf = dirs = strdup( env );
+    if ( NULL == SH_PATH_INDEX.env || NULL == dirs ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_SIGUSR2_handler(): incorrect signal caught ( caught: %d )\n", sig );
+        fprintf( stdout, "\t@sh_path_sync(): strdup for $PATH failed: %s\n", strerror( errno ) );
+
+        // Free resources ( index stays empty and will be rebuilt on next call )
+        sh_path_flush();
 
         // Return failure
         return;
 
     }
 
-    // Check if is main process that enters
-    if ( SH_PID != getpid() ) {
+    // Split $PATH in directories ( empty entries are the working directory )
+    for ( ndirs = 1, dir = dirs; NULL != ( dir = strchr( dir, ':' ) ); ++dir, ++ndirs );
+    SH_PATH_INDEX.dirs = ( char ** ) calloc( ndirs, sizeof( char * ) );
+    SH_PATH_INDEX.mtimes = ( struct timespec * ) calloc( ndirs, sizeof( struct timespec ) );
+    if ( NULL == SH_PATH_INDEX.dirs || NULL == SH_PATH_INDEX.mtimes ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_SIGUSR2_handler(): only main process should receive a SIGUSR2 signal\n" );
+        fprintf( stdout, "\t@sh_path_sync(): calloc for $dirs failed: %s\n", strerror( errno ) );
+
+        // Free resources
+        sh_path_flush();
 
         // Return failure
         return;
 
     }
 
-    // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 ) {
-
-        fprintf( stdout, "\t@sh_SIGUSR2_handler(): main process was sent a SIGUSR2\n" );
-        fprintf( stdout, "\t@sh_SIGUSR2_handler(): will try to read from shared memory\n" );
-
-    }
-
-    // Vars
-    pid_t cpid;
-    sh_cmd_t cmd;
-    sh_bltcmd_t bltcmd;
-    size_t temp, add = 0, i;
-    bool result;
+    for ( i = 0; NULL != ( dir = strsep( &dirs, ":" ) ); ) {
 
-    /*
-    * -----------------------------------------------
-    * Transmission Protocol
-    * -----------------------------------------------
-    *
-    * The sent data stored in memory are the following:
-    *  - [pid_t]:      pid
-    *  - [size_t]:     strlen(cmd)
-    *  - [char *]      cmd
-    *  - [size_t]:     nargs
-    *  - [size_t]:     strlen(arg{0})
-    *  - [char *]      arg{0}
-    *  - [size_t]:     strlen(arg{1})
-    *  - [char *]      arg{1}
-    *  -        ...
-    *  - [size_t]:     strlen(arg{n-1})
-    *  - [char *]      arg{n-1}
-    *  - [size_t]:     strlen(glue_b)
-    *  - [char *]      glue_b
-    *  - [size_t]:     strlen(glue_a)
-    *  - [char *]      glue_a
-    *  - [bool]:       is_blt
-    *  - [bltcmd]      bltcmd
-    *
-    * -----------------------------------------------
-    *
-    */
-    // pid
-    memcpy( &cpid, SH_SHARED_MEMORY_PTR + add, sizeof( pid_t ) );
-    add += sizeof( pid_t );
-    // strlen(cmd)
-    memcpy( &temp, SH_SHARED_MEMORY_PTR + add, sizeof( size_t ) );
-    add += sizeof( size_t );
-    // Init cmd->cmd
-    cmd.cmd = ( char * ) calloc( temp, sizeof( char ) );
-    // cmd
-    memcpy( cmd.cmd, SH_SHARED_MEMORY_PTR + add, temp * sizeof( char ) );
-    add += temp * sizeof( char );
-    // nargs
-    memcpy( &temp, SH_SHARED_MEMORY_PTR + add, sizeof( size_t ) );
-    add += temp * sizeof( size_t );
-    // Init args
-    cmd.nargs = temp;
-    cmd.args = ( char ** ) calloc( temp, sizeof( *cmd.args ) );
-    // args
-    for ( i = 0; i < cmd.nargs - 1; ++i ) {
-
-        // strlen( arg( i ) )
-        memcpy( &temp, SH_SHARED_MEMORY_PTR + add, sizeof( size_t ) );
-        add += temp * sizeof( size_t );
-
-        // Alloc arg( i )
-        *( cmd.args + i ) = ( char * ) calloc( ARG_LEN_MAX, sizeof( char ) );
-
-        // arg( i )
-        memcpy( *( cmd.args + i ), SH_SHARED_MEMORY_PTR + add, temp * sizeof( char ) );
-        add += temp * sizeof( char );
-
-    }
-    // Last arg is a null argument
-    *( cmd.args + cmd.nargs - 1 ) = NULL;  // ARGS_END
-    // strlen(glue_b)
-    memcpy( &temp, SH_SHARED_MEMORY_PTR + add, sizeof( size_t ) );
-    add += sizeof( size_t );
-    // Init glue_b
-    cmd.glue_b = ( char * ) calloc( temp, sizeof( char ) );
-    // glue_b
-    memcpy( cmd.glue_b, SH_SHARED_MEMORY_PTR + add, temp * sizeof( char ) );
-    add += temp * sizeof( char );
-    // strlen(glue_a)
-    memcpy( &temp, SH_SHARED_MEMORY_PTR + add, sizeof( size_t ) );
-    add += sizeof( size_t );
-    // Init glue_b
-    cmd.glue_a = ( char * ) calloc( temp, sizeof( char ) );
-    // glue_a
-    memcpy( cmd.glue_a, SH_SHARED_MEMORY_PTR + add, temp * sizeof( char ) );
-    add += temp * sizeof( char );
-    // is_blt
-    memcpy( &cmd.is_blt, SH_SHARED_MEMORY_PTR + add, sizeof( bool ) );
-    add += sizeof( bool );
-    // Get bltcmd
-    memcpy( &bltcmd, SH_SHARED_MEMORY_PTR + add, sizeof( sh_bltcmd_t ) );
-    // Copy
-    cmd.bltcmd = &bltcmd;
-    // cmd is now parsed
-    cmd.is_prs = true;
-
-    // Assign methods
-    cmd.utils = cmdutils;
-
-    // Re-construction finished
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-        fprintf( stdout, "\t@sh_SIGUSR2_handler(): memcpy finished. start response to $cpid = %d\n", cpid );
-
-    // Inspect $cmd
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 ) sh_cmd_inspect( &cmd );
-
-    // Execute
-    result = cmd.bltcmd->exec( &cmd );
-
-    // Write result to memory
-    memcpy( SH_SHARED_MEMORY_PTR, &result, sizeof( bool ) );
+        if ( '\0' == *dir ) dir = ".";
 
-    // Free resources
-    free( cmd.cmd );
-    for ( i = 0; i < cmd.nargs; ++i ) {
+        // Relative directories are resolved in the current working directory
+        if ( '/' != *dir && NULL == SH_PATH_INDEX.wd ) SH_PATH_INDEX.wd = strdup( SH_WD );
 
-        // Check arg and free
-        if ( NULL != cmd.args[ i ] )
-            free( cmd.args[ i ] );
+        // Save directory and its mtime
+        *( SH_PATH_INDEX.dirs + i ) = dir;
+        if ( stat( dir, &st ) == 0 ) *( SH_PATH_INDEX.mtimes + i ) = st.st_mtim;
+        i++;
 
     }
-    free( cmd.args );
-
-    // Send a signal to child that we finished
-    kill( cpid, SIGUSR1 );
+    SH_PATH_INDEX.ndirs = i;
 
 }
-void sh_SIGINT_handler ( int sig ) {
+/*
+ * Resolve command's name to an executable's path
+ *
+ * Names containing '/' are not searched in $PATH ( they are checked as is ). All other names are looked up in the
+ * index and, on a miss, searched in $PATH directories in order. sh_path_sync() should have been called before.
+ *
+ * @param cmd [string]: The command's name
+ * @return [string]: The path of the executable or NULL if none found. The string is owned by the index.
+ */
+const char *sh_path_lookup ( const char *cmd ) {
 
-    //Check signal
-    if ( SIGINT != sig ) {
+    // Vars
+    sh_pathent_t *ent;
+    struct stat st;
+    char *path;
+    size_t hash, i;
 
-        // Report error
-        fprintf( stdout, "\t@sh_SIGINT_handler(): incorrect signal caught ( caught: %s )", strsignal( sig ) );
+    // Paths are not cached, since they may be relative to the working directory
+    if ( NULL != strchr( cmd, '/' ) )
+        return stat( cmd, &st ) == 0 && S_ISREG( st.st_mode ) && access( cmd, X_OK ) == 0 ? cmd : NULL;
 
-        // Return failure
-        return;
+    // Make sure index has room ( load factor at most 1/2 )
+    if ( ( SH_PATH_INDEX.nused + 1 ) * 2 > SH_PATH_INDEX.nslots && !sh_path_grow() ) return NULL;
 
-    }
+    // Search index
+    hash = sh_path_hash( cmd );
+    ent = sh_path_slot( SH_PATH_INDEX.slots, SH_PATH_INDEX.nslots, cmd, hash );
+    if ( NULL != ent->cmd ) {
 
-    // Vars
-    pid_t pid;
+        // DEBUGGING:
+        if ( SH_DBG( 2 ) )
+            fprintf( stdout, "\t@sh_path_lookup(): '%s': hit ( %s )\n", cmd, NULL != ent->path ? ent->path : "(null)" );
 
-    // Get entered processes' pid
-    pid = getpid();
+        return ent->path;
 
-    // Check the id of entered process
-    // main process shows the output screen and toggles $SH_QUIT
-    // child processes exit here
-    if ( SH_PID == pid ) {
+    }
 
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_SIGINT_handler(): stopping due to SIGINT receipt\n" );
+    // Miss: search $PATH directories in order
+    path = NULL;
+    for ( i = 0; i < SH_PATH_INDEX.ndirs; ++i ) {
 
-        // Close stdin
-        if ( EOF == fclose( stdin ) ) {
+        // Build candidate
+        path = ( char * ) malloc( strlen( *( SH_PATH_INDEX.dirs + i ) ) + strlen( cmd ) + 2 );
+        if ( NULL == path ) {
 
             // Report error
-            fprintf( stdout, "\t@sh_SIGINT_handler(): stdin: error closing file: %s\n", strerror( errno ) );
-
-        }
+            fprintf( stdout, "\t@sh_path_lookup(): malloc for $path failed: %s\n", strerror( errno ) );
 
-        // Check if currently executing a command
-        // If a command is executing and SH_FORCE_QUIT is false then set it to true
-        // else kill children as well as parent
-        if ( SH_EXECUTING && !SH_FORCE_QUIT ) {
+            // Return failure ( not cached )
+            return NULL;
 
-            // Raise the SH_QUIT, SH_FORCE QUIT
-            SH_QUIT = true;
-            SH_FORCE_QUIT = true;
+        }
+        sprintf( path, "%s/%s", *( SH_PATH_INDEX.dirs + i ), cmd );
 
-            // Exit waiting for next signal
-            return;
+        // Check candidate
+        if ( stat( path, &st ) == 0 && S_ISREG( st.st_mode ) && access( path, X_OK ) == 0 ) break;
 
-        }
+        free( path );
+        path = NULL;
 
-        // Show bye screen
-        sh_prt_bye();
+    }
 
-        // Kill all process in group
-        killpg( SH_PGID, SIGTERM );
+    // Save result ( misses too )
+    ent->cmd = strdup( cmd );
+    if ( NULL == ent->cmd ) {
 
-    } else {
+        // Report error
+        fprintf( stdout, "\t@sh_path_lookup(): strdup for $cmd failed: %s\n", strerror( errno ) );
 
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_SIGINT_handler(): child dying due to SIGINT receipt\n" );
+        // Free resources
+        free( path );
 
-        // Kill child by sending it a SIGTERM signal
-        kill( pid, SIGTERM );
+        // Return failure
+        return NULL;
 
     }
-
-}
-void sh_SIGIGN_handler ( int sig ) {
+    ent->path = path;
+    ent->hash = hash;
+    SH_PATH_INDEX.nused++;
 
     // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-        fprintf( stdout, "\t@sh_SIGIGN_handler(): signal %d ( %s ) received and ignored\n", sig, strsignal( sig ) );
+    if ( SH_DBG( 2 ) )
+        fprintf( stdout, "\t@sh_path_lookup(): '%s': miss ( %s )\n", cmd, NULL != path ? path : "(null)" );
+
+    return path;
 
 }
 
 /*
- * ------------------
- * Built-in commands
- * ------------------
- *
- * Here we define all of are shell's built-in commands.
- * All commands' names are stored in $SH_BUILTIN_CMDS_DEF global variable
- *
- */
-
+* ------------------
+* Get env methods
+* ------------------
+*
+*/
 /*
- * Change directory
+ * Get env var with named after $key
  *
- * To change current directory we simply execute C's built-in chdir().
+ * Try searching in env, if found sh_cmd_parse value and return. If not found
+ * set the default value and return the $def default value
  *
- * @param path [string]: The path to cd to. If NULL, then goes back to initial working directory ( env var: $CH_WD_I )
+ * @param [string] key: The key to search in getenv()
+ * @param [int] def: The default value returned if getenv() fails
+ *                   This value is also set in env of $key
  *
  */
-bool sh_bltcmd_cd ( const sh_cmd_t *cmd ) {
-
-    // Check command
-    if ( NULL == cmd ) {
-
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_cd(): unable to parse NULL argument\n" );
-
-        // Return failure
-        return false;
-
-    }
+int sh_get_env ( const char *key, const int def ) {
 
     // Vars
-    const char *tmp;
-
-    // Check $path
-    if ( NULL == *( cmd->args + 1 ) ) {
-
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_bltcmd_cd(): no path given, setting path to home: %s\n", getenv( "SH_WD_I\n" ) );
-
-        // No path given
-        // cd to $SH_WD_I
-        tmp = SH_WD_I;
-
-    } else {
-
-        // Path given
-        tmp = *( cmd->args + 1 );
-
-    }
-
-    // Change directory
-    if ( chdir( tmp ) == -1 ) {
+    char *value, *test;
+    int val;
 
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_cd(): error changing directory ( PATH = %s ): %s\n", tmp, strerror( errno ) );
+    // Get env variable
+    value = getenv( key );
+    if ( NULL == value ) {
 
-        // Return failure
-        return false;
+        // Error getting env variable
+        // Return default value
+        return def;
 
     }
 
-    // If reached here, directory changed successfully
-    // Update $SH_WD via getcwd()
-    getcwd( SH_WD, 1024 );
-    if ( NULL == SH_WD ) {
-
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_cd(): strdup for $SH_WD failed: %s\n", strerror( errno ) );
+    // Parse value to integer
+    val = ( int ) strtol( value, &test, 10 );
+    if ( value == test ) {
 
-        // Return failure ( FALSE )
-        return false;
+        // Strtol failed
+        // Revert to default value
+        return def;
 
     }
 
-    // Return success
-    return true;
+    // returned retrieved value
+    return val;
 
 }
-bool sh_bltcmd_set ( const sh_cmd_t *cmd ) {
+void sh_set_env ( const char *key, int val ) {
 
-    // Check command
-    if ( NULL == cmd ) {
+    // Vars
+    char *valstr;
+
+    // Alloc mem for valstr
+    valstr = ( char * ) calloc( ROW_LEN_MAX, sizeof( char ) );
+    if ( NULL == valstr ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_set(): unable to parse NULL argument\n" );
+        fprintf( stdout, "\t@sh_set_env(): calloc for $valstr failed: %s\n", strerror( errno ) );
 
         // Return failure
-        return false;
+        return;
 
     }
 
-    // Vars
-    char *value, glue;
-    size_t nargs, i;      // The number of arguments to be glued together and stored to value
+    // Convert int $val to string via sprintf
+    if ( 0 > sprintf( valstr, "%d", val ) ) {
 
-    // Check args
-    if ( cmd->nargs < 4 || NULL == *( cmd->args + 1 ) || NULL == *( cmd->args + 2 ) ) {
+        // sprintf() failed
+        // Report error
+        fprintf( stdout, "\t@sh_set_env(): sprintf failed: %s\n", strerror( errno ) );
 
-        // DEBUGGING:
-        fprintf( stdout, "\t@sh_bltcmd_set(): wrong invocation: usage set VARNAME VARVALUE\n" );
+        // Free resources
+        free( valstr );
 
-        // No arg given
-        return false;
+        // Return failure
+        return;
 
     }
 
-    // Allocate $value
-    value = ( char * ) calloc( ROW_LEN_MAX, sizeof( char ) );
-    if ( NULL == value ) {
+    // Set environment variable
+    if ( -1 == setenv( key, valstr, 1 ) ) {
 
+        // setenv() failed
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_set(): calloc for $value failed: %s\n", strerror( errno ) );
-
-        // Return failure
-        return false;
+        fprintf( stdout, "\t@sh_set_env(): setenv failed: %s\n", strerror( errno ) );
 
     }
 
-    // Get number of useful arguments
-    nargs = cmd->nargs - 4;
+    // Free resources
+    free( valstr );
 
-    // Init value with first useful argument
-    sprintf( value, "%s", *( cmd->args + 2 ) );
+}
+/*
+ * Reload runtime configuration from environment
+ *
+ * $SH_CONF caches the SH_* variables of $SH_CONF_VARS, so that hot paths read a plain field instead of getenv()
+ * and strtol(). Every change to the environment of those variables must be followed by a call to this function.
+ *
+ * @param [string] key: The variable that changed, or NULL to reload all
+ *
+ */
+void sh_conf_sync ( const char *key ) {
 
-    // Append all other arguments, gluing them with ';'
-    glue = ';';
-    for ( i = 0; i < nargs; ++i ) {
+    // Vars
+    size_t i;
 
-        // Add glue
-        strncat( value, &glue, 1 );
+    for ( i = 0; i < sizeof( SH_CONF_VARS ) / sizeof( sh_confvar_t ); ++i )
+        if ( NULL == key || 0 == strcmp( key, SH_CONF_VARS[ i ].key ) )
+            *SH_CONF_VARS[ i ].val = sh_get_env( SH_CONF_VARS[ i ].key, SH_CONF_VARS[ i ].def );
 
-        // Add next argument
-        strcat( value, *( cmd->args + 3 + i ) );
+}
 
-    }
-
-    // Set variable with setenv()
-    if ( setenv( *( cmd->args + 1 ), value, 1 ) == -1 ) {
+/*
+ * ---------
+ * Printers
+ * ---------
+ *
+ */
+void sh_prt_welcome ( void ) {
 
-        // Report error
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_bltcmd_set(): error setting env variable: %s\n", strerror( errno ) );
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "=================================\n" );
+    fprintf( stdout, "     Welcome to CHShell v%s\n", VERSION );
+    fprintf( stdout, "---------------------------------\n" );
+    fprintf( stdout, "Author: Charisoudis D. Athanasios\n" );
+    fprintf( stdout, "=================================\n" );
+    fprintf( stdout, "\n" );
 
-        // Free resources
-        free( value );
+}
+void sh_prt_bye ( void ) {
 
-        // Return failure
-        return false;
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "Thanks for using this shell\n" );
+    fprintf( stdout, "=================================\n" );
+    fprintf( stdout, "          CHShell v%s\n", VERSION );
+    fprintf( stdout, "---------------------------------\n" );
+    fprintf( stdout, "Author: Charisoudis D. Athanasios\n" );
+    fprintf( stdout, "=================================\n" );
+    fprintf( stdout, "\n" );
 
-    }
+}
 
-    // Free resources
-    free( value );
+/*
+ * --------------
+ * Signal events
+ * --------------
+ *
+ * The main process blocks SIGCHLD and SIGINT and reads them from $SH_SIG_FD, as events of its loop ( see
+ * sh_ipc_poll() ): they are handled in ordinary context, never interrupting the shell. Children restore the mask
+ * ( see sh_fork() and $SH_SPAWNATTR ), so they keep the default actions.
+ *
+ */
+void sh_sig_serve ( void ) {
 
-    // Return success
-    return true;
+    // Vars
+    struct signalfd_siginfo info;
+    bool chld;
 
-}
-bool sh_bltcmd_unset ( const sh_cmd_t *cmd ) {
+    // Drain signals ( several SIGCHLD may be merged into one )
+    chld = false;
+    while ( read( SH_SIG_FD, &info, sizeof( info ) ) == sizeof( info ) ) {
 
-    // Check command
-    if ( NULL == cmd ) {
+        if ( SIGCHLD == info.ssi_signo ) chld = true;
+        else if ( SIGINT == info.ssi_signo ) sh_sig_int();
+        else {
 
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_unset(): unable to parse NULL argument\n" );
+            // Report error
+            fprintf( stdout, "\t@sh_sig_serve(): incorrect signal caught ( caught: %u )\n", info.ssi_signo );
 
-        // Return failure
-        return false;
+        }
 
     }
 
-    // Check args
-    if ( cmd->nargs < 3 || NULL == *( cmd->args + 1 ) ) {
-
-        // DEBUGGING:
-        fprintf( stdout, "\t@sh_bltcmd_unset(): wrong invocation: usage set VARNAME\n" );
+    // Collect jobs' state changes
+    if ( chld ) sh_job_reap();
 
-        // No arg given
-        return false;
+}
+void sh_sig_int ( void ) {
 
-    }
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_sig_int(): stopping due to SIGINT receipt\n" );
 
-    // Set variable with setenv()
-    if ( unsetenv( *( cmd->args + 1 ) ) == -1 ) {
+    // Check if currently executing a command
+    // If a command is executing and SH_FORCE_QUIT is false then set it to true
+    // else kill children as well as parent
+    if ( SH_EXECUTING && !SH_FORCE_QUIT ) {
 
-        // Report error
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_bltcmd_unset(): error unsetting env variable: %s\n", strerror( errno ) );
+        // Raise the SH_QUIT, SH_FORCE QUIT
+        SH_QUIT = true;
+        SH_FORCE_QUIT = true;
 
-        // Return failure
-        return false;
+        // Exit waiting for next signal
+        return;
 
     }
 
-    // Return success
-    return true;
-
-}
-bool sh_bltcmd_get ( const sh_cmd_t *cmd ) {
-
-    // Check command
-    if ( NULL == cmd ) {
+    // Show bye screen ( headless runs stop quietly )
+    if ( !SH_HEADLESS ) sh_prt_bye();
+    fflush( stdout );
 
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_get(): unable to parse NULL argument\n" );
+    // Kill all process in group ( only interactive mode owns one, else $SH_PGID is 0: the caller's group )
+    if ( 0 != SH_PGID ) killpg( SH_PGID, SIGTERM );
 
-        // Return failure
-        return false;
+    // Exit as interrupted
+    exit( 128 + SIGINT );
 
-    }
+}
+pid_t sh_fork ( void ) {
 
     // Vars
-    const char *envvar;
+    pid_t pid;
 
-    // Check args
-    if ( cmd->nargs < 3 || NULL == *( cmd->args + 1 ) ) {
+    // Child gets the default signal handling back
+    pid = fork();
+    if ( 0 == pid ) sigprocmask( SIG_SETMASK, &SH_SIGMASK, NULL );
 
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_bltcmd_get(): wrong invocation: usage get VARNAME\n" );
+    return pid;
 
-        // No arg given
-        return false;
+}
 
-    }
+/*
+ * --------------------------
+ * Built-in command requests
+ * --------------------------
+ *
+ * Built-in commands flagged with $run_in_main_process, when executed by a child process, are sent to the main
+ * process to be executed there.
+ *
+ * The requester creates a private stream socket pair and passes one end to the main process over the shared
+ * $SH_IPC_FD channel ( SOCK_SEQPACKET, so each request's announcement is one atomic message ). The request itself
+ * is then framed on the private socket, so any number of concurrent requesters and payloads of any size are
+ * supported, and each response reaches exactly its requester.
+ *
+ * The main process serves requests from sh_waitpid() / sh_wait_input() ( i.e. whenever it would block ), never from
+ * a signal handler.
+ *
+ * -----------------------------------------------------
+ * Transmission Protocol ( on the private socket )
+ * -----------------------------------------------------
+ *
+ * The request:
+ *  - [size_t]:     nargs ( excluding the terminating NULL )
+ *  - [size_t]:     strlen(arg{0})
+ *  - [char *]      arg{0} ( the command's name )
+ *  -        ...
+ *  - [size_t]:     strlen(arg{n-1})
+ *  - [char *]      arg{n-1}
+ *
+ * The response:
+ *  - [bool]:       result
+ *
+ * -----------------------------------------------------
+ *
+ */
+/*
+ * Read / write exactly $len bytes from / to $fd ( retrying on interrupts and partial transfers )
+ *
+ * @return [bool]: FALSE if the peer closed or an error occurred, TRUE otherwise
+ */
+static bool sh_ipc_read ( int fd, void *buf, size_t len ) {
 
-    // Get env variable and return it
-    envvar = getenv( *( cmd->args + 1 ) );
-    if ( NULL == envvar ) {
+    // Vars
+    ssize_t n;
 
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_get(): %s: error getting env variable: %s\n", *( cmd->args + 1 ),
-                 strerror( errno ) );
+    while ( len > 0 ) {
 
-        // Return failure
-        return false;
+        n = read( fd, buf, len );
+        if ( n < 0 && EINTR == errno ) continue;
+        if ( n <= 0 ) return false;
 
-    }
+        buf = ( char * ) buf + n;
+        len -= ( size_t ) n;
 
-    // Echo variable
-    fprintf( stdout, "%s\n", envvar );
+    }
 
-    // Return success
     return true;
 
 }
-bool sh_bltcmd_cls ( const sh_cmd_t *cmd ) {
-
-    // Check command
-    if ( NULL == cmd ) {
+static bool sh_ipc_write ( int fd, const void *buf, size_t len ) {
 
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_cls(): unable to parse NULL argument\n" );
+    // Vars
+    ssize_t n;
 
-        // Return failure
-        return false;
+    while ( len > 0 ) {
 
-    }
+        n = send( fd, buf, len, MSG_NOSIGNAL );
+        if ( n < 0 && EINTR == errno ) continue;
+        if ( n <= 0 ) return false;
 
-    // Just execute a cls()
-    sh_cls();
+        buf = ( const char * ) buf + n;
+        len -= ( size_t ) n;
 
-    // Print welcome screen
-    sh_prt_welcome();
+    }
 
-    // Return success
     return true;
 
 }
-bool sh_bltcmd_sleep ( const sh_cmd_t *cmd ) {
+/*
+ * Create the requests' channel and the main process' event loop ( SIGCHLD, SIGINT must be blocked already )
+ *
+ * Must be called by the main process, before any child is created.
+ */
+bool sh_ipc_init ( void ) {
 
-    // Check command
-    if ( NULL == cmd ) {
+    // Requests' channel ( not inherited by exec'd commands )
+    if ( socketpair( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, SH_IPC_FD ) < 0 ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_sleep(): unable to parse NULL argument\n" );
+        fprintf( stdout, "\t@sh_ipc_init(): socketpair failed: %s\n", strerror( errno ) );
 
         // Return failure
         return false;
 
     }
 
+    // Main process never blocks on the channel
+    fcntl( SH_IPC_FD[ READ_EDGE ], F_SETFL, O_NONBLOCK );
+
     // Vars
-    char *testptr;
-    unsigned int rt, t;
+    sigset_t set;
+    struct epoll_event ev;
 
-    // Execute a sleep( cmd->arg[1] )
-    // Check if arg was supplied
-    if ( cmd->nargs < 3 || NULL == *( cmd->args + 1 ) ) {
+    // Signals as descriptor
+    sigemptyset( &set );
+    sigaddset( &set, SIGCHLD );
+    sigaddset( &set, SIGINT );
+    SH_SIG_FD = signalfd( -1, &set, SFD_CLOEXEC | SFD_NONBLOCK );
+    if ( SH_SIG_FD < 0 ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_sleep(): usage sleep {SECONDS}\n" );
+        fprintf( stdout, "\t@sh_ipc_init(): signalfd failed: %s\n", strerror( errno ) );
 
         // Return failure
         return false;
 
     }
 
-    // Parse argument to integer with strtol()
-    t = ( unsigned int ) strtol( *( cmd->args + 1 ), &testptr, 10 );
-    if ( *( cmd->args + 1 ) == testptr ) {
+    // Event loop over requests and signals ( input is added while waiting for it )
+    SH_EPOLL_FD = epoll_create1( EPOLL_CLOEXEC );
+    ev.events = EPOLLIN;
+    ev.data.fd = SH_IPC_FD[ READ_EDGE ];
+    if ( SH_EPOLL_FD < 0 || epoll_ctl( SH_EPOLL_FD, EPOLL_CTL_ADD, SH_IPC_FD[ READ_EDGE ], &ev ) < 0 ||
+         ( ev.data.fd = SH_SIG_FD, epoll_ctl( SH_EPOLL_FD, EPOLL_CTL_ADD, SH_SIG_FD, &ev ) ) < 0 ) {
 
-        // strtol() failed
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_sleep(): strtol failed: %s\n", strerror( errno ) );
+        fprintf( stdout, "\t@sh_ipc_init(): epoll failed: %s\n", strerror( errno ) );
 
         // Return failure
         return false;
 
     }
 
-    // Execute sleep()
-    if ( 0 != ( rt = sleep( t ) ) ) {
+    return true;
 
-        // sleep() did not slept for all time $t
-        // Report error
-        fprintf( stdout, "\t@sh_bltcmd_sleep(): sleep failed ( remaining time: %d seconds): %s\n", rt,
-                 strerror( errno ) );
+}
+/*
+ * Send built-in command to the main process and wait for its result
+ *
+ * @param cmd [sh_cmd_t]: The ( parsed ) built-in command
+ * @return [bool]: The execution result in main process or FALSE if transmission failed
+ */
+bool sh_ipc_request ( const sh_cmd_t *cmd ) {
 
-        // Return failure
-        return false;
+    // Vars
+    int chan[2];
+    size_t nargs, len, i;
+    pid_t pid;
+    bool result, sent;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char ctrl[CMSG_SPACE( sizeof( int ) )];
 
-    }
+    // Only main process may hold the receiving edge ( else a pending request outlives main process )
+    if ( SH_IPC_FD[ READ_EDGE ] >= 0 && SH_PID != getpid() ) {
 
-    // Return success
-    return true;
+        close( SH_IPC_FD[ READ_EDGE ] );
+        SH_IPC_FD[ READ_EDGE ] = -1;
 
-}
-bool sh_bltcmd_help ( const sh_cmd_t *cmd ) { // TODO
+    }
 
-    // Check command
-    if ( NULL == cmd ) {
+    // Create private channel
+    if ( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, chan ) < 0 ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_help(): unable to parse NULL argument\n" );
+        fprintf( stdout, "\t@sh_ipc_request(): socketpair failed: %s\n", strerror( errno ) );
 
         // Return failure
         return false;
 
     }
 
-    // Show a not implemented message
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, "\t@sh_bltcmd_help(): not implemented yet\n" );
-
-    return false;
+    // Announce request, passing main process its end of the private channel
+    pid = getpid();
+    memset( &msg, 0, sizeof( struct msghdr ) );
+    memset( ctrl, 0, sizeof( ctrl ) );
+    iov.iov_base = &pid;
+    iov.iov_len = sizeof( pid_t );
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof( ctrl );
+    cmsg = CMSG_FIRSTHDR( &msg );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN( sizeof( int ) );
+    memcpy( CMSG_DATA( cmsg ), &chan[ READ_EDGE ], sizeof( int ) );
+
+    sent = sendmsg( SH_IPC_FD[ WRITE_EDGE ], &msg, MSG_NOSIGNAL ) >= 0;
+    close( chan[ READ_EDGE ] );
+
+    // Write request
+    nargs = cmd->nargs - 1;
+    sent = sent && sh_ipc_write( chan[ WRITE_EDGE ], &nargs, sizeof( size_t ) );
+    for ( i = 0; sent && i < nargs; ++i ) {
+
+        len = strlen( *( cmd->args + i ) );
+        sent = sh_ipc_write( chan[ WRITE_EDGE ], &len, sizeof( size_t ) ) &&
+               sh_ipc_write( chan[ WRITE_EDGE ], *( cmd->args + i ), len );
 
-}
-bool sh_bltcmd_exit ( const sh_cmd_t *cmd ) {
+    }
 
-    // Check command
-    if ( NULL == cmd ) {
+    // Wait for response
+    result = false;
+    if ( !sent || !sh_ipc_read( chan[ WRITE_EDGE ], &result, sizeof( bool ) ) ) {
 
         // Report error
-        fprintf( stdout, "\t@sh_bltcmd_exit(): unable to parse NULL argument\n" );
+        fprintf( stdout, "\t@sh_ipc_request(): %s: request to main process failed: %s\n", cmd->cmd,
+                 strerror( errno ) );
 
-        // Return failure
-        return false;
+        result = false;
 
     }
 
-    // Just set the global variable $SH_QUIT to TRUE
-    SH_QUIT = true;
+    // Free resources
+    close( chan[ WRITE_EDGE ] );
 
-    // Return success
-    return true;
+    return result;
 
 }
-
 /*
- * --------------------
- * Execution Functions
- * --------------------
- *
- */
-/*
- * Parsing & Execution of raw command line input
- *
- * It creates a sh_row_t object with commands that need to be executed out of raw data.
- * Returns TRUE if all commands executed with no errors, FALSE if at least one command failed.
- *
- * To tweak behavior, try changing global variables, $ON_ROW_ERROR_ABORT and $ON_FROW_ERROR_ABORT.
- *
- * @param raw [string]: shell raw line that needs to be parsed to sh_row_t object and executed
+ * Serve one request read from the private channel $fd
  */
-bool sh_parse_exec_row ( const char *raw ) {
+static void sh_ipc_serve_one ( int fd, pid_t cpid ) {
 
-    //Vars
-    bool result;
-    size_t i, j;
-    sh_row_t row;
+    // Vars
+    sh_cmd_t cmd;
+    size_t nargs, len, i;
+    bool result, ok;
+    sh_mark_t mark;
+
+    // Read request ( into $SH_ARENA, above whatever the interrupted row holds )
+    mark = sh_arena_mark( &SH_ARENA );
+    ok = sh_ipc_read( fd, &nargs, sizeof( size_t ) );
+    cmd.args = ok ? ( char ** ) sh_arena_alloc( &SH_ARENA, ( nargs + 1 ) * sizeof( char * ) ) : NULL;
+    ok = ok && NULL != cmd.args;
+    for ( i = 0; ok && i < nargs; ++i ) {
+
+        ok = sh_ipc_read( fd, &len, sizeof( size_t ) ) &&
+             NULL != ( *( cmd.args + i ) = ( char * ) sh_arena_alloc( &SH_ARENA, len + 1 ) ) &&
+             sh_ipc_read( fd, *( cmd.args + i ), len );
+        if ( ok ) *( *( cmd.args + i ) + len ) = '\0';
 
-    // Init $row
-    row.utils = rowutils;
+    }
+    if ( ok ) *( cmd.args + nargs ) = NULL;
 
-    // Copy raw data
-    row.raw = ( char * ) malloc( strlen( raw ) + 1 );
-    if ( NULL == row.raw ||  NULL == strcpy( row.raw, raw ) ) {
+    // Re-construct command
+    result = false;
+    if ( ok && nargs > 0 ) {
 
-        // Report error
-        fprintf( stdout, "\t@sh_parse_exec_row(): malloc / strcpy for $row.raw failed: %s\n", strerror( errno ) );
+        cmd.cmd = *cmd.args;
+        cmd.nargs = nargs + 1;
+        cmd.glue_b = "";
+        cmd.glue_a = "";
+        cmd.is_prs = true;
+        cmd.utils = cmdutils;
 
-        // Return failure
-        return false;
+        // Only built-in commands are served
+        cmd.bltcmd = sh_blt_lookup( cmd.cmd );
+        cmd.is_blt = NULL != cmd.bltcmd;
 
-    }
+        // DEBUGGING:
+        if ( SH_DBG( 2 ) ) {
+            fprintf( stdout, "\t@sh_ipc_serve(): request from $cpid = %d\n", cpid );
+            sh_cmd_inspect( &cmd );
+        }
 
-    // Trim whole row
-    row.utils->trim( &row );
+        // Execute
+        if ( cmd.is_blt ) result = cmd.bltcmd->exec( &cmd );
+        else fprintf( stdout, "\t@sh_ipc_serve(): %s: not a built-in command\n", cmd.cmd );
 
-    // Check if row is comment or empty
-    if ( sh_strlen( row.raw ) == 0 || row.utils->iscomment( &row ) )
-    {
-        result = true;
-        row.ncmds = 0;
-    }
-    else
-    {
-        // Parse row to commands
-        row.utils->parse(&row);
+    } else {
 
-        // Inspect
-        if (sh_get_env(SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT) >= 2)
-            row.utils->inspect(&row);
+        // Report error
+        fprintf( stdout, "\t@sh_ipc_serve(): malformed request from $cpid = %d\n", cpid );
 
-        // Execute the commands in row with the exec() method
-        result = row.utils->exec(&row);
+    }
 
-        // Free resources
-        for (i = 0; i < row.ncmds; ++i) {
-            free((row.cmds + i)->cmd);
-            for (j = 0; j < (row.cmds + j)->nargs; ++j) {
+    // Write response ( requester may have died in the meantime )
+    sh_ipc_write( fd, &result, sizeof( bool ) );
 
-                // Check arg and free
-                if (NULL != (row.cmds + i)->args[j]) {
-                    free((row.cmds + i)->args[j]);
-                }
+    // Free resources
+    sh_arena_release( &SH_ARENA, mark );
 
-            }
-        }
-        if (row.cmds) free(row.cmds);
-    }
+}
+/*
+ * Serve all pending requests ( main process only )
+ */
+void sh_ipc_serve ( void ) {
 
-    // Free resources
-    free(row.raw);
+    // Vars
+    int fd;
+    pid_t cpid;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char ctrl[CMSG_SPACE( sizeof( int ) )];
+
+    // Drain channel
+    while ( true ) {
+
+        // Receive next announcement
+        memset( &msg, 0, sizeof( struct msghdr ) );
+        iov.iov_base = &cpid;
+        iov.iov_len = sizeof( pid_t );
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof( ctrl );
+        if ( recvmsg( SH_IPC_FD[ READ_EDGE ], &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC ) <= 0 ) break;
+
+        // Get requester's channel
+        cmsg = CMSG_FIRSTHDR( &msg );
+        if ( NULL == cmsg || SCM_RIGHTS != cmsg->cmsg_type ) continue;
+        memcpy( &fd, CMSG_DATA( cmsg ), sizeof( int ) );
+
+        // Serve
+        sh_ipc_serve_one( fd, cpid );
+        close( fd );
 
-    // return execution result
-    return result;
+    }
 
 }
 /*
- * Execution of a major command set between ';'
+ * Register ( or re-arm ) input descriptor $fd in the event loop
  *
- * Major command-set is chunked in minor command-sets that are executed by sh_exec_minor_command_set()
- * This is done to maintain parsing priorities and a bash-like shell behavior
- *
- * @param row [sh_row_t]: The row object, which holds all commands of the parsed row
- * @param idx [size_t]: The index in $raw->cmds of the first command in command-set
- * @param ncmds [size_t]: Number of commands in command-set
+ * Input is one-shot: while nobody waits for it, a readable terminal must not keep waking up the loop.
  *
+ * @return [int]: 0 on success, 1 if $fd cannot be polled ( regular files are always readable ), -1 on error
  */
-bool sh_exec_major_command_set ( const sh_row_t *row, size_t idx, size_t ncmds ) {
+static int sh_ipc_arm ( int fd ) {
 
     // Vars
-    size_t from, mcmds, i;
-    bool result, result_ov;
-    pid_t cpid;
+    struct epoll_event ev;
+    int op;
 
-    // Init
-    from = idx;
-    mcmds = 1;
-    result_ov = true;
+    if ( fd == SH_EPOLL_IN && SH_EPOLL_ARMED ) return 0;
 
-    /*
-     * ------------------------------
-     * Background Execution of MAJOR
-     * ------------------------------
-     *
-     * Check if command set should be run in background ( last commands ends with '&' )
-     * If last command is background then the command set should run in background
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = fd;
+
+    // Same descriptor: re-arm ( it may have been closed and reused meanwhile, then add it again )
+    op = fd == SH_EPOLL_IN ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if ( EPOLL_CTL_ADD == op && -1 != SH_EPOLL_IN ) epoll_ctl( SH_EPOLL_FD, EPOLL_CTL_DEL, SH_EPOLL_IN, NULL );
+    SH_EPOLL_IN = -1;
+    if ( epoll_ctl( SH_EPOLL_FD, op, fd, &ev ) < 0 &&
+         ( ENOENT != errno || epoll_ctl( SH_EPOLL_FD, EPOLL_CTL_ADD, fd, &ev ) < 0 ) )
+        return EPERM == errno ? 1 : -1;
+
+    SH_EPOLL_IN = fd;
+    SH_EPOLL_ARMED = true;
+
+    return 0;
+
+}
+/*
+ * Block until $fd is readable ( or until any event if $fd is -1 ), serving requests and signals meanwhile
+ *
+ * @return [int]: 1 if $fd is readable, 0 if woken up for any other reason, -1 on error
+ */
+static int sh_ipc_poll ( int fd, int timeout ) {
+
+    // Vars
+    struct epoll_event evs[EPOLL_EVS_LEN];
+    int n, i, ready;
+
+    // Register input
+    if ( -1 != fd && 0 != ( ready = sh_ipc_arm( fd ) ) ) return ready;
+
+    // Wait
+    n = epoll_wait( SH_EPOLL_FD, evs, EPOLL_EVS_LEN, timeout );
+    if ( n < 0 ) return EINTR == errno ? 0 : -1;
+
+    // Handle events
+    for ( ready = 0, i = 0; i < n; ++i ) {
+
+        // Serve requests
+        if ( evs[ i ].data.fd == SH_IPC_FD[ READ_EDGE ] ) sh_ipc_serve();
+
+        // Handle signals ( Ctrl + C, children's state changes )
+        else if ( evs[ i ].data.fd == SH_SIG_FD ) sh_sig_serve();
+
+        // Input ( disarmed now )
+        else if ( evs[ i ].data.fd == SH_EPOLL_IN ) {
+            SH_EPOLL_ARMED = false;
+            if ( fd == SH_EPOLL_IN ) ready = 1;
+        }
+
+    }
+
+    return ready;
+
+}
+/*
+ * Wait for child $pid to terminate
+ *
+ * In the main process, built-in command requests are served while waiting ( the child, or one of its own children,
+ * may be the requester ). Other processes simply block in waitpid().
+ */
+pid_t sh_waitpid ( pid_t pid, int *status ) {
+
+    // Vars
+    pid_t rpid;
+
+    // Not the main process, or no channel
+    if ( SH_PID != getpid() || -1 == SH_IPC_FD[ READ_EDGE ] ) return waitpid( pid, status, 0 );
+
+    // Poll child's state, serving requests meanwhile
+    while ( 0 == ( rpid = waitpid( pid, status, WNOHANG ) ) )
+        if ( sh_ipc_poll( -1, -1 ) < 0 ) return waitpid( pid, status, 0 );
+
+    return rpid;
+
+}
+/*
+ * Wait for input on $fd ( e.g. the terminal ), serving requests meanwhile ( main process only )
+ */
+void sh_wait_input ( int fd ) {
+
+    if ( SH_PID != getpid() || -1 == SH_IPC_FD[ READ_EDGE ] ) return;
+    while ( 0 == sh_ipc_poll( fd, -1 ) );
+
+}
+/*
+ * Sleep for $t seconds, serving requests meanwhile ( main process only, else plain sleep() )
+ *
+ * @return [unsigned int]: Zero, or the seconds left unslept on error
+ */
+unsigned int sh_sleep ( unsigned int t ) {
+
+    // Vars
+    struct timespec now, end;
+    long ms;
+
+    if ( SH_PID != getpid() || -1 == SH_IPC_FD[ READ_EDGE ] ) return sleep( t );
+
+    // Poll until deadline
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    end.tv_sec += t;
+    for ( ;; ) {
+
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        ms = ( end.tv_sec - now.tv_sec ) * 1000 + ( end.tv_nsec - now.tv_nsec ) / 1000000;
+        if ( ms <= 0 ) return 0;
+        if ( sh_ipc_poll( -1, ( int ) ms ) < 0 ) return ( unsigned int ) ( ms / 1000 ) + 1;
+
+    }
+
+}
+
+/*
+ * ----------
+ * Job table
+ * ----------
+ *
+ * Background command-sets started by the main process are jobs. Each one runs in its own process group ( led by
+ * the job's process ), so that a job is signalled as a whole and Ctrl + C in the foreground does not reach it.
+ *
+ * Jobs are numbered from 1, reusing the lowest free id, and are stored at their id's index: finding a job by id is
+ * an array access. A pid index ( open addressing ) finds the job of a terminated child in O(1) as well, e.g. when a
+ * batch scheduler's waitpid( -1 ) collects it. The index is rebuilt when jobs are removed, which only happens when
+ * finished jobs are reported.
+ *
+ * Jobs' states are collected by sh_job_reap() whenever the main process is woken by a SIGCHLD ( see sh_ipc_poll() ).
+ *
+ */
+/*
+ * Find the pid index's slot of $pid
+ *
+ * @return [size_t *]: The slot of $pid's job, or the free slot it should be inserted at
+ */
+static size_t *sh_job_slot ( pid_t pid ) {
+
+    // Vars
+    size_t i;
+
+    // Linear probing ( the index is never full )
+    for ( i = ( size_t ) pid * 2654435761U & ( SH_JOBTAB.nslots - 1 ); 0 != *( SH_JOBTAB.slots + i );
+          i = ( i + 1 ) & ( SH_JOBTAB.nslots - 1 ) )
+        if ( ( SH_JOBTAB.jobs + *( SH_JOBTAB.slots + i ) - 1 )->pid == pid ) break;
+
+    return SH_JOBTAB.slots + i;
+
+}
+/*
+ * Rebuild the pid index ( load factor at most 1/2 )
+ *
+ * @return [bool]: FALSE if the index could not be allocated, TRUE otherwise
+ */
+static bool sh_job_index ( void ) {
+
+    // Vars
+    size_t nslots, i;
+    size_t *slots;
+
+    for ( nslots = JOB_IDX_LEN; nslots < 2 * SH_JOBTAB.cap; nslots <<= 1 );
+    slots = ( size_t * ) calloc( nslots, sizeof( size_t ) );
+    if ( NULL == slots ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_job_index(): calloc for $slots failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+    free( SH_JOBTAB.slots );
+    SH_JOBTAB.slots = slots;
+    SH_JOBTAB.nslots = nslots;
+
+    for ( i = 0; i < SH_JOBTAB.njobs; ++i )
+        if ( 0 != ( SH_JOBTAB.jobs + i )->pid ) *sh_job_slot( ( SH_JOBTAB.jobs + i )->pid ) = i + 1;
+
+    return true;
+
+}
+/*
+ * Remove a job ( its id becomes free )
+ */
+static void sh_job_remove ( sh_job_t *job ) {
+
+    // Vars
+    size_t id;
+
+    id = ( size_t ) ( job - SH_JOBTAB.jobs ) + 1;
+    if ( 'd' != job->state ) SH_JOBTAB.nlive--;
+    free( job->cmd );
+    memset( job, 0, sizeof( sh_job_t ) );
+
+    // Drop trailing free ids
+    while ( SH_JOBTAB.njobs > 0 && 0 == ( SH_JOBTAB.jobs + SH_JOBTAB.njobs - 1 )->pid ) SH_JOBTAB.njobs--;
+    if ( SH_JOBTAB.cur == id ) SH_JOBTAB.cur = SH_JOBTAB.njobs;
+
+    sh_job_index();
+
+}
+/*
+ * Add a job
+ *
+ * @param pid [pid_t]: The job's process
+ * @param cmd [string]: The job's command-set ( malloc'd, owned by the job from now on )
+ * @return [size_t]: The job's id, or 0 on failure ( reported )
+ */
+size_t sh_job_add ( pid_t pid, char *cmd ) {
+
+    // Vars
+    sh_job_t *jobs;
+    size_t id, cap;
+
+    // Lowest free id
+    for ( id = 1; id <= SH_JOBTAB.njobs && 0 != ( SH_JOBTAB.jobs + id - 1 )->pid; ++id );
+
+    // Grow table ( and its index )
+    if ( id > SH_JOBTAB.cap ) {
+
+        cap = 0 == SH_JOBTAB.cap ? JOB_IDX_LEN / 2 : 2 * SH_JOBTAB.cap;
+        jobs = ( sh_job_t * ) realloc( SH_JOBTAB.jobs, cap * sizeof( sh_job_t ) );
+        if ( NULL == jobs ) {
+
+            // Report error
+            fprintf( stdout, "\t@sh_job_add(): realloc for $jobs failed: %s\n", strerror( errno ) );
+
+            // Return failure
+            free( cmd );
+            return 0;
+
+        }
+        memset( jobs + SH_JOBTAB.cap, 0, ( cap - SH_JOBTAB.cap ) * sizeof( sh_job_t ) );
+        SH_JOBTAB.jobs = jobs;
+        SH_JOBTAB.cap = cap;
+        if ( !sh_job_index() ) {
+            free( cmd );
+            return 0;
+        }
+
+    }
+
+    // Fill and index it
+    ( SH_JOBTAB.jobs + id - 1 )->pid = pid;
+    ( SH_JOBTAB.jobs + id - 1 )->state = 'r';
+    ( SH_JOBTAB.jobs + id - 1 )->cmd = cmd;
+    *sh_job_slot( pid ) = id;
+    if ( id > SH_JOBTAB.njobs ) SH_JOBTAB.njobs = id;
+    SH_JOBTAB.nlive++;
+    SH_JOBTAB.cur = id;
+
+    return id;
+
+}
+/*
+ * Find the job of a process
+ *
+ * @return [sh_job_t *]: The job, or NULL if $pid is not a job's process
+ */
+sh_job_t *sh_job_find ( pid_t pid ) {
+
+    // Vars
+    size_t slot;
+
+    if ( 0 == SH_JOBTAB.njobs ) return NULL;
+    slot = *sh_job_slot( pid );
+
+    return 0 == slot ? NULL : SH_JOBTAB.jobs + slot - 1;
+
+}
+/*
+ * Find a job by its specification: "%n" or "n" for job n, "%%" / "%+" or NULL for the current job
+ *
+ * @return [sh_job_t *]: The job, or NULL if there is no such job ( reported )
+ */
+sh_job_t *sh_job_get ( const char *spec ) {
+
+    // Vars
+    size_t id;
+    char *end;
+
+    // Parse id
+    if ( NULL == spec || 0 == strcmp( spec, "%%" ) || 0 == strcmp( spec, "%+" ) ) id = SH_JOBTAB.cur;
+    else {
+        id = ( size_t ) strtoul( spec + ( '%' == *spec ), &end, 10 );
+        if ( '\0' != *end ) id = 0;
+    }
+
+    // Check it
+    if ( 0 == id || id > SH_JOBTAB.njobs || 0 == ( SH_JOBTAB.jobs + id - 1 )->pid ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_job_get(): %s: no such job\n", NULL == spec ? "current" : spec );
+
+        // Return failure
+        return NULL;
+
+    }
+
+    return SH_JOBTAB.jobs + id - 1;
+
+}
+/*
+ * Record a job's state change ( $status as returned by waitpid(), ignored if $pid is not a job's process )
+ */
+void sh_job_update ( pid_t pid, int status ) {
+
+    // Vars
+    sh_job_t *job;
+
+    job = sh_job_find( pid );
+    if ( NULL == job || 'd' == job->state ) return;
+
+    if ( WIFSTOPPED( status ) ) {
+        job->state = 's';
+        SH_JOBTAB.cur = ( size_t ) ( job - SH_JOBTAB.jobs ) + 1;
+    } else if ( WIFCONTINUED( status ) ) job->state = 'r';
+    else {
+        job->state = 'd';
+        job->status = status;
+        SH_JOBTAB.nlive--;
+    }
+
+}
+/*
+ * Collect state changes of all jobs ( never blocks )
+ */
+void sh_job_reap ( void ) {
+
+    // Vars
+    size_t i;
+    int status;
+
+    if ( SH_PID != getpid() || 0 == SH_JOBTAB.nlive ) return;
+
+    for ( i = 0; i < SH_JOBTAB.njobs; ++i )
+        if ( 0 != ( SH_JOBTAB.jobs + i )->pid && 'd' != ( SH_JOBTAB.jobs + i )->state &&
+             waitpid( ( SH_JOBTAB.jobs + i )->pid, &status, WNOHANG | WUNTRACED | WCONTINUED ) > 0 )
+            sh_job_update( ( SH_JOBTAB.jobs + i )->pid, status );
+
+}
+/*
+ * Print a job's state
+ */
+static void sh_job_print ( const sh_job_t *job ) {
+
+    // Vars
+    size_t id;
+
+    id = ( size_t ) ( job - SH_JOBTAB.jobs ) + 1;
+    fprintf( stdout, "[%zu]%c  %-7ld ", id, id == SH_JOBTAB.cur ? '+' : ' ', ( long ) job->pid );
+
+    if ( 'r' == job->state ) fprintf( stdout, "%-24s", "Running" );
+    else if ( 's' == job->state ) fprintf( stdout, "%-24s", "Stopped" );
+    else if ( WIFSIGNALED( job->status ) ) fprintf( stdout, "%-24s", strsignal( WTERMSIG( job->status ) ) );
+    else if ( EXIT_SUCCESS == WEXITSTATUS( job->status ) ) fprintf( stdout, "%-24s", "Done" );
+    else fprintf( stdout, "Exit %-19d", WEXITSTATUS( job->status ) );
+
+    fprintf( stdout, "%s\n", job->cmd );
+
+}
+/*
+ * Report finished jobs and remove them ( interactive mode, before the prompt )
+ */
+void sh_job_notify ( void ) {
+
+    // Vars
+    size_t i;
+
+    sh_job_reap();
+    for ( i = 0; i < SH_JOBTAB.njobs; ++i )
+        if ( 0 != ( SH_JOBTAB.jobs + i )->pid && 'd' == ( SH_JOBTAB.jobs + i )->state ) {
+            sh_job_print( SH_JOBTAB.jobs + i );
+            sh_job_remove( SH_JOBTAB.jobs + i );
+        }
+
+}
+/*
+ * Wait for a job to finish ( or stop ), serving requests meanwhile
+ *
+ * In foreground, with a terminal, the job gets the terminal while it runs. Waiting ends early if the shell is
+ * interrupted ( $SH_QUIT ).
+ *
+ * @param fg [bool]: Wait in foreground
+ * @return [bool]: TRUE if the job finished successfully, FALSE otherwise
+ */
+static bool sh_job_wait ( sh_job_t *job, bool fg ) {
+
+    // Vars
+    sigset_t ttou, old;
+    bool tty, block;
+    int status;
+    pid_t rpid;
+
+    // Give it the terminal
+    tty = fg && 'm' == SH_MODE && isatty( STDIN_FILENO );
+    if ( tty ) tcsetpgrp( STDIN_FILENO, job->pid );
+
+    // Wait ( blocking in waitpid() if there is no event loop, or it failed, as sh_waitpid() does )
+    block = -1 == SH_IPC_FD[ READ_EDGE ];
+    while ( 'r' == job->state && !SH_QUIT ) {
+
+        rpid = waitpid( job->pid, &status, block ? WUNTRACED : WNOHANG | WUNTRACED );
+        if ( rpid > 0 ) sh_job_update( job->pid, status );
+        else if ( rpid < 0 ) {
+
+            if ( EINTR == errno ) continue;
+
+            // Collected elsewhere without being recorded: its outcome is unknown, so it failed
+            job->state = 'd';
+            job->status = W_EXITCODE( EXIT_FAILURE, 0 );
+            SH_JOBTAB.nlive--;
+
+        } else if ( sh_ipc_poll( -1, -1 ) < 0 ) block = true;
+
+    }
+
+    // Take the terminal back ( as a background process now, so SIGTTOU must not stop the shell )
+    if ( tty ) {
+        sigemptyset( &ttou );
+        sigaddset( &ttou, SIGTTOU );
+        sigprocmask( SIG_BLOCK, &ttou, &old );
+        tcsetpgrp( STDIN_FILENO, SH_PGID );
+        sigprocmask( SIG_SETMASK, &old, NULL );
+    }
+
+    return 'd' == job->state && WIFEXITED( job->status ) && EXIT_SUCCESS == WEXITSTATUS( job->status );
+
+}
+/*
+ * Remove all jobs ( they keep running )
+ */
+void sh_job_flush ( void ) {
+
+    // Vars
+    size_t i;
+
+    for ( i = 0; i < SH_JOBTAB.njobs; ++i ) free( ( SH_JOBTAB.jobs + i )->cmd );
+    free( SH_JOBTAB.jobs );
+    free( SH_JOBTAB.slots );
+    memset( &SH_JOBTAB, 0, sizeof( sh_jobtab_t ) );
+
+}
+
+/*
+ * ------------------
+ * Built-in commands
+ * ------------------
+ *
+ * Here we define all of are shell's built-in commands.
+ * All commands' names are stored in $SH_BUILTIN_CMDS_DEF global variable
+ *
+ * Commands are matched against the built-ins through a perfect hash of their length, first and last byte, which
+ * sh_blt_init() generates from $SH_BUILTIN_CMDS at start-up. A lookup costs one hash and at most one strcmp().
+ *
+ */
+/*
+ * Hash of a command's name ( multiplicative, the top BLT_IDX_BITS bits are the slot )
+ */
+static size_t sh_blt_hash ( uint32_t seed, const char *cmd, size_t len ) {
+
+    // Vars
+    uint32_t key;
+
+    // Init
+    key = ( uint32_t ) len << 16 | ( uint32_t ) ( unsigned char ) *cmd << 8 | ( unsigned char ) *( cmd + len - 1 );
+
+    return ( size_t ) ( ( key * seed ) >> ( 32 - BLT_IDX_BITS ) );
+
+}
+/*
+ * Generate the built-in commands' perfect hash
+ *
+ * Searches for a seed that maps every built-in to its own slot. Built-ins sharing length, first and last byte
+ * can never be separated: they are reported and the shell exits.
+ */
+void sh_blt_init ( void ) {
+
+    // Vars
+    size_t nbcmds, i, slot;
+    uint32_t seed;
+
+    // Init
+    nbcmds = sizeof( SH_BUILTIN_CMDS ) / sizeof( *SH_BUILTIN_CMDS );
+
+    // Try odd seeds ( starting from Knuth's multiplier ) until no two built-ins collide
+    for ( seed = 2654435761U; seed != 2654435761U + 2 * 65536U; seed += 2 ) {
+
+        memset( SH_BLT_IDX, 0, sizeof( SH_BLT_IDX ) );
+        for ( i = 0; i < nbcmds; ++i ) {
+
+            slot = sh_blt_hash( seed, ( SH_BUILTIN_CMDS + i )->cmd, strlen( ( SH_BUILTIN_CMDS + i )->cmd ) );
+            if ( 0 != *( SH_BLT_IDX + slot ) ) break;
+            *( SH_BLT_IDX + slot ) = ( unsigned char ) ( i + 1 );
+
+        }
+
+        // Perfect
+        if ( i == nbcmds ) {
+
+            // DEBUGGING:
+            if ( SH_DBG( 2 ) )
+                fprintf( stdout, "\t@sh_blt_init(): %zu built-in commands hashed ( seed: %u )\n", nbcmds, seed );
+
+            SH_BLT_SEED = seed;
+            return;
+
+        }
+
+    }
+
+    // Report error
+    fprintf( stdout, "\t@sh_blt_init(): no perfect hash for built-in commands ( '%s' collides )\n",
+             ( SH_BUILTIN_CMDS + i )->cmd );
+
+    // Exit with failure
+    exit( EXIT_FAILURE );
+
+}
+/*
+ * Find built-in command by its name
+ *
+ * @param cmd [string]: The command's name
+ * @return [sh_bltcmd_t *]: The built-in command or NULL if $cmd is not a built-in
+ */
+sh_bltcmd_t *sh_blt_lookup ( const char *cmd ) {
+
+    // Vars
+    size_t len, slot;
+
+    // Init
+    len = strlen( cmd );
+    if ( 0 == len ) return NULL;
+
+    // Find slot, then compare with the only built-in it may hold
+    slot = *( SH_BLT_IDX + sh_blt_hash( SH_BLT_SEED, cmd, len ) );
+    if ( 0 == slot || strcmp( ( SH_BUILTIN_CMDS + slot - 1 )->cmd, cmd ) != 0 ) return NULL;
+
+    return SH_BUILTIN_CMDS + slot - 1;
+
+}
+
+/*
+ * Change directory
+ *
+ * To change current directory we simply execute C's built-in chdir().
+ *
+ * @param path [string]: The path to cd to. If NULL, then goes back to initial working directory ( env var: $CH_WD_I )
+ *
+ */
+bool sh_bltcmd_cd ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_cd(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    const char *tmp;
+
+    // Check $path
+    if ( NULL == *( cmd->args + 1 ) ) {
+
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_bltcmd_cd(): no path given, setting path to home: %s\n", getenv( "SH_WD_I\n" ) );
+
+        // No path given
+        // cd to $SH_WD_I
+        tmp = SH_WD_I;
+
+    } else {
+
+        // Path given
+        tmp = *( cmd->args + 1 );
+
+    }
+
+    // Change directory
+    if ( chdir( tmp ) == -1 ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_cd(): error changing directory ( PATH = %s ): %s\n", tmp, strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // If reached here, directory changed successfully
+    // Update $SH_WD via getcwd()
+    getcwd( SH_WD, 1024 );
+    if ( NULL == SH_WD ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_cd(): strdup for $SH_WD failed: %s\n", strerror( errno ) );
+
+        // Return failure ( FALSE )
+        return false;
+
+    }
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_set ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_set(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    char *value;
+    size_t nargs, i, len, pos;  // The number of arguments to be glued together and stored to value
+    sh_mark_t mark;
+
+    // Check args
+    if ( cmd->nargs < 4 || NULL == *( cmd->args + 1 ) || NULL == *( cmd->args + 2 ) ) {
+
+        // DEBUGGING:
+        fprintf( stdout, "\t@sh_bltcmd_set(): wrong invocation: usage set VARNAME VARVALUE\n" );
+
+        // No arg given
+        return false;
+
+    }
+
+    // Get number of useful arguments
+    nargs = cmd->nargs - 4;
+
+    // Allocate $value ( all useful arguments, glued )
+    for ( len = 0, i = 0; i <= nargs; ++i ) len += strlen( *( cmd->args + 2 + i ) ) + 1;
+    mark = sh_arena_mark( &SH_ARENA );
+    value = ( char * ) sh_arena_alloc( &SH_ARENA, len );
+    if ( NULL == value ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_set(): sh_arena_alloc for $value failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Concatenate first useful argument and all others, gluing them with ';'
+    for ( pos = 0, i = 0; i <= nargs; ++i ) {
+
+        // Add glue
+        if ( i > 0 ) *( value + pos++ ) = ';';
+
+        // Add next argument
+        len = strlen( *( cmd->args + 2 + i ) );
+        memcpy( value + pos, *( cmd->args + 2 + i ), len );
+        pos += len;
+
+    }
+    *( value + pos ) = '\0';
+
+    // Set variable with setenv()
+    if ( setenv( *( cmd->args + 1 ), value, 1 ) == -1 ) {
+
+        // Report error
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_bltcmd_set(): error setting env variable: %s\n", strerror( errno ) );
+
+        // Free resources
+        sh_arena_release( &SH_ARENA, mark );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Free resources
+    sh_arena_release( &SH_ARENA, mark );
+
+    // Update cached configuration
+    sh_conf_sync( *( cmd->args + 1 ) );
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_unset ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_unset(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Check args
+    if ( cmd->nargs < 3 || NULL == *( cmd->args + 1 ) ) {
+
+        // DEBUGGING:
+        fprintf( stdout, "\t@sh_bltcmd_unset(): wrong invocation: usage set VARNAME\n" );
+
+        // No arg given
+        return false;
+
+    }
+
+    // Set variable with setenv()
+    if ( unsetenv( *( cmd->args + 1 ) ) == -1 ) {
+
+        // Report error
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_bltcmd_unset(): error unsetting env variable: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Update cached configuration
+    sh_conf_sync( *( cmd->args + 1 ) );
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_get ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_get(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    const char *envvar;
+
+    // Check args
+    if ( cmd->nargs < 3 || NULL == *( cmd->args + 1 ) ) {
+
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_bltcmd_get(): wrong invocation: usage get VARNAME\n" );
+
+        // No arg given
+        return false;
+
+    }
+
+    // Get env variable and return it
+    envvar = getenv( *( cmd->args + 1 ) );
+    if ( NULL == envvar ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_get(): %s: error getting env variable: %s\n", *( cmd->args + 1 ),
+                 strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Echo variable
+    fprintf( stdout, "%s\n", envvar );
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_cls ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_cls(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Just execute a cls()
+    sh_cls();
+
+    // Print welcome screen
+    sh_prt_welcome();
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_sleep ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_sleep(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    char *testptr;
+    unsigned int rt, t;
+
+    // Execute a sleep( cmd->arg[1] )
+    // Check if arg was supplied
+    if ( cmd->nargs < 3 || NULL == *( cmd->args + 1 ) ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_sleep(): usage sleep {SECONDS}\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Parse argument to integer with strtol()
+    t = ( unsigned int ) strtol( *( cmd->args + 1 ), &testptr, 10 );
+    if ( *( cmd->args + 1 ) == testptr ) {
+
+        // strtol() failed
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_sleep(): strtol failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Execute sleep()
+    if ( 0 != ( rt = sh_sleep( t ) ) ) {
+
+        // sleep() did not slept for all time $t
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_sleep(): sleep failed ( remaining time: %d seconds): %s\n", rt,
+                 strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_help ( const sh_cmd_t *cmd ) { // TODO
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_help(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Show a not implemented message
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_bltcmd_help(): not implemented yet\n" );
+
+    return false;
+
+}
+bool sh_bltcmd_exit ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_exit(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Just set the global variable $SH_QUIT to TRUE
+    SH_QUIT = true;
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_jobs ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_jobs(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    size_t i;
+
+    // Collect states, then list all jobs ( finished ones are removed once listed )
+    sh_job_reap();
+    for ( i = 0; i < SH_JOBTAB.njobs; ++i )
+        if ( 0 != ( SH_JOBTAB.jobs + i )->pid ) {
+            sh_job_print( SH_JOBTAB.jobs + i );
+            if ( 'd' == ( SH_JOBTAB.jobs + i )->state ) sh_job_remove( SH_JOBTAB.jobs + i );
+        }
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_fg ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_fg(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    sh_job_t *job;
+    bool result;
+
+    // Find job ( current one by default )
+    job = sh_job_get( cmd->nargs > 2 ? *( cmd->args + 1 ) : NULL );
+    if ( NULL == job ) return false;
+    fprintf( stdout, "%s\n", job->cmd );
+    fflush( stdout );
+
+    // Continue it and wait for it
+    if ( 's' == job->state ) {
+        killpg( job->pid, SIGCONT );
+        job->state = 'r';
+    }
+    result = sh_job_wait( job, true );
+
+    // Report a stopped job, forget a finished one ( an interrupted wait leaves it running )
+    if ( 's' == job->state ) {
+        fprintf( stdout, "\n" );
+        sh_job_print( job );
+    } else if ( 'd' == job->state ) sh_job_remove( job );
+
+    return result;
+
+}
+bool sh_bltcmd_bg ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_bg(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    sh_job_t *job;
+
+    // Find job ( current one by default )
+    job = sh_job_get( cmd->nargs > 2 ? *( cmd->args + 1 ) : NULL );
+    if ( NULL == job ) return false;
+    if ( 'd' == job->state ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_bg(): %s: job has terminated\n", job->cmd );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Continue it
+    if ( killpg( job->pid, SIGCONT ) < 0 ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_bg(): killpg failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+    job->state = 'r';
+    fprintf( stdout, "[%zu] %s &\n", ( size_t ) ( job - SH_JOBTAB.jobs ) + 1, job->cmd );
+
+    // Return success
+    return true;
+
+}
+bool sh_bltcmd_wait ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_wait(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    sh_job_t *job;
+    size_t i;
+    bool result;
+
+    // No arguments: wait for all running jobs ( always succeeds, as in bash ), stopped ones are skipped
+    if ( cmd->nargs < 3 ) {
+        for ( i = 0; i < SH_JOBTAB.njobs && !SH_QUIT; ++i )
+            if ( 0 != ( SH_JOBTAB.jobs + i )->pid ) {
+                sh_job_wait( SH_JOBTAB.jobs + i, false );
+                if ( 'd' == ( SH_JOBTAB.jobs + i )->state ) sh_job_remove( SH_JOBTAB.jobs + i );
+            }
+        return true;
+    }
+
+    // Wait for given jobs, result is the last one's ( a stopped job is not waited for and fails )
+    for ( result = true, i = 1; i + 1 < cmd->nargs && !SH_QUIT; ++i ) {
+        job = sh_job_get( *( cmd->args + i ) );
+        if ( NULL == job ) {
+            result = false;
+            continue;
+        }
+        result = sh_job_wait( job, false );
+        if ( 'd' == job->state ) sh_job_remove( job );
+    }
+
+    return result;
+
+}
+bool sh_bltcmd_kill ( const sh_cmd_t *cmd ) {
+
+    // Check command
+    if ( NULL == cmd ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_kill(): unable to parse NULL argument\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Vars
+    sh_job_t *job;
+    const char *name, *abbrev;
+    char *end;
+    size_t i;
+    int sig;
+    long pid;
+    bool result;
+
+    // Parse signal: -SIG, -s SIG, -N ( SIGTERM by default, 0 only checks that the targets exist )
+    sig = SIGTERM;
+    i = 1;
+    if ( i + 1 < cmd->nargs && '-' == **( cmd->args + i ) ) {
+
+        name = *( cmd->args + i ) + 1;
+        if ( 0 == strcmp( name, "s" ) && i + 2 < cmd->nargs ) name = *( cmd->args + ++i );
+        if ( 0 == strncasecmp( name, "SIG", 3 ) ) name += 3;
+        sig = ( int ) strtol( name, &end, 10 );
+        if ( name == end || '\0' != *end )
+            for ( sig = 1; sig < NSIG; ++sig )
+                if ( NULL != ( abbrev = sigabbrev_np( sig ) ) && 0 == strcasecmp( name, abbrev ) ) break;
+        if ( sig < 0 || sig >= NSIG ) {
+
+            // Report error
+            fprintf( stdout, "\t@sh_bltcmd_kill(): %s: invalid signal\n", *( cmd->args + i ) );
+
+            // Return failure
+            return false;
+
+        }
+        ++i;
+
+    }
+
+    // Check targets
+    if ( i + 1 >= cmd->nargs ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_bltcmd_kill(): usage kill [-SIGNAL | -s SIGNAL] {%%JOB | PID}...\n" );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Signal jobs ( their whole process group ) or processes, terminated jobs cannot be signalled
+    sh_job_reap();
+    for ( result = true; i + 1 < cmd->nargs; ++i ) {
+
+        if ( '%' == **( cmd->args + i ) ) {
+            job = sh_job_get( *( cmd->args + i ) );
+            if ( NULL == job ) result = false;
+            else if ( 'd' == job->state ) {
+                fprintf( stdout, "\t@sh_bltcmd_kill(): %s: job has terminated\n", *( cmd->args + i ) );
+                result = false;
+            } else if ( killpg( job->pid, sig ) < 0 ) {
+                fprintf( stdout, "\t@sh_bltcmd_kill(): %s: killpg failed: %s\n", *( cmd->args + i ), strerror( errno ) );
+                result = false;
+            }
+            continue;
+        }
+
+        pid = strtol( *( cmd->args + i ), &end, 10 );
+        if ( *( cmd->args + i ) == end || '\0' != *end ) {
+            fprintf( stdout, "\t@sh_bltcmd_kill(): %s: not a job or a pid\n", *( cmd->args + i ) );
+            result = false;
+        } else if ( kill( ( pid_t ) pid, sig ) < 0 ) {
+            fprintf( stdout, "\t@sh_bltcmd_kill(): %s: kill failed: %s\n", *( cmd->args + i ), strerror( errno ) );
+            result = false;
+        }
+
+    }
+
+    return result;
+
+}
+
+/*
+ * --------------------
+ * Execution Functions
+ * --------------------
+ *
+ */
+/*
+ * Parsing of raw command line input
+ *
+ * The row is trimmed and looked up in the plan cache; a missed row is parsed, its built-in commands are resolved and
+ * it is inserted in the cache. All of $row's memory is taken from $SH_ARENA: callers take a mark before and release
+ * it when done with $row.
+ *
+ * @param raw [string]: shell raw line that needs to be parsed to sh_row_t object ( not NULL-terminated )
+ * @param size [size_t]: length of $raw
+ * @param row [sh_row_t]: The row to fill ( with no commands, if $raw is empty or a comment )
+ * @param cached [bool]: Use the plan cache ( main thread only )
+ * @return [bool]: TRUE if $row was filled, FALSE on failure ( reported )
+ */
+bool sh_row_load ( const char *raw, size_t size, sh_row_t *row, bool cached ) {
+
+    //Vars
+    sh_planent_t *ent;
+    size_t left, right, len, hash, i;
+    char *blk;
+
+    // Trim leading and trailing spaces ( the trimmed row is the plan cache's key )
+    left = 0;
+    right = size;
+    while ( left < right && isspace( ( unsigned char ) *( raw + left ) ) ) left++;
+    while ( right > left && isspace( ( unsigned char ) *( raw + right - 1 ) ) ) right--;
+    len = right - left;
+
+    // Init $row
+    row->utils = rowutils;
+    row->ncmds = 0;
+    row->plan = NULL;
+    row->root = SIZE_MAX;
+
+    // Empty row has no commands
+    if ( 0 == len ) return true;
+
+    // Search plan cache
+    hash = cached ? sh_plan_hash( raw + left, len ) : 0;
+    ent = cached ? sh_plan_lookup( raw + left, len, hash ) : NULL;
+    if ( NULL != ent ) {
+
+        // Copy cached row ( execution edits its commands )
+        blk = ( char * ) sh_arena_alloc( &SH_ARENA, sh_plan_size( &ent->row ) );
+        if ( NULL == blk ) {
+
+            // Report error
+            fprintf( stdout, "\t@sh_row_load(): sh_arena_alloc for cached row failed: %s\n", strerror( errno ) );
+
+            // Return failure
+            return false;
+
+        }
+        sh_plan_copy( row, &ent->row, blk );
+        return true;
+
+    }
+
+    // Copy trimmed raw data
+    row->raw = ( char * ) sh_arena_alloc( &SH_ARENA, len + 1 );
+    if ( NULL == row->raw ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_row_load(): sh_arena_alloc for $row.raw failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+    memcpy( row->raw, raw + left, len );
+    *( row->raw + len ) = '\0';
+
+    // Comments have no commands
+    if ( row->utils->iscomment( row ) ) return true;
+
+    // Parse row to commands
+    row->utils->parse( row );
+
+    // Resolve built-ins before caching, so that cached rows skip it too
+    for ( i = 0; i < row->ncmds; ++i ) ( row->cmds + i )->utils->parse( row->cmds + i );
+    if ( cached ) sh_plan_insert( row, hash );
+
+    return true;
+
+}
+/*
+ * Check if a row changes the shell's state ( uses a built-in that runs in the main process, e.g. cd, set )
+ */
+static bool sh_row_stateful ( const sh_row_t *row ) {
+
+    // Vars
+    size_t i;
+
+    for ( i = 0; i < row->ncmds; ++i )
+        if ( ( row->cmds + i )->is_blt && ( row->cmds + i )->bltcmd->run_in_main_process ) return true;
+
+    return false;
+
+}
+/*
+ * Parsing & Execution of raw command line input
+ *
+ * It creates a sh_row_t object with commands that need to be executed out of raw data.
+ * Returns TRUE if all commands executed with no errors, FALSE if at least one command failed.
+ *
+ * To tweak behavior, try changing global variables, $ON_ROW_ERROR_ABORT and $ON_FROW_ERROR_ABORT.
+ *
+ * @param raw [string]: shell raw line that needs to be parsed to sh_row_t object and executed ( not NULL-terminated )
+ * @param size [size_t]: length of $raw
+ */
+bool sh_parse_exec_row ( const char *raw, size_t size ) {
+
+    //Vars
+    bool result;
+    sh_row_t row;
+    sh_mark_t mark;
+
+    // Parse row ( all of its memory is taken from $SH_ARENA, above $mark )
+    mark = sh_arena_mark( &SH_ARENA );
+    result = sh_row_load( raw, size, &row, true );
+
+    // Empty rows and comments always succeed
+    if ( result && 0 != row.ncmds ) {
+
+        // Inspect
+        if ( SH_DBG( 2 ) )
+            row.utils->inspect( &row );
+
+        // Execute the commands in row with the exec() method
+        result = row.utils->exec( &row );
+
+    }
+
+    // Free resources ( whole row at once )
+    sh_arena_release( &SH_ARENA, mark );
+
+    // return execution result
+    return result;
+
+}
+/*
+ * Describe a background command-set for the job table, e.g. "sleep 5 | wc -l"
+ *
+ * @param row [sh_row_t]: The row object
+ * @param node [size_t]: The SH_OP_BG node
+ * @return [string]: The description ( malloc'd ), NULL on failure
+ */
+static char *sh_job_describe ( const sh_row_t *row, size_t node ) {
+
+    // Vars
+    const sh_cmd_t *cmd;
+    size_t first, ncmds, len, i, j;
+    char *str, *p;
+
+    // First command of the operand is its leftmost pipeline's first stage
+    ncmds = ( row->plan + node )->rhs;
+    for ( first = ( row->plan + node )->lhs; SH_OP_PIPE != ( row->plan + first )->op;
+          first = ( row->plan + first )->lhs );
+    first = ( row->plan + first )->lhs;
+
+    // Measure
+    for ( len = 1, i = first; i < first + ncmds; ++i ) {
+        cmd = row->cmds + i;
+        for ( j = 0; j + 1 < cmd->nargs; ++j ) len += strlen( *( cmd->args + j ) ) + 1;
+        len += strlen( cmd->glue_a ) + 1;
+    }
+
+    // Join arguments and glues
+    str = ( char * ) malloc( len );
+    if ( NULL == str ) return strdup( row->raw );
+    for ( p = str, i = first; i < first + ncmds; ++i ) {
+        cmd = row->cmds + i;
+        for ( j = 0; j + 1 < cmd->nargs; ++j ) p += sprintf( p, 0 == j ? "%s" : " %s", *( cmd->args + j ) );
+        if ( i + 1 < first + ncmds ) p += sprintf( p, " %s ", cmd->glue_a );
+    }
+    *p = '\0';
+
+    return str;
+
+}
+/*
+ * Execution of a plan's node
+ *
+ * Walks the ( sub- ) tree rooted at $node, following bash's rules:
+ *  - ';': both operands are executed, the result is the right one's
+ *  - '&&': right operand is executed only if left one succeeded
+ *  - '||': right operand is executed only if left one failed
+ *  - '&': operand is executed in a forked child, the result is always success
+ *  - pipelines are executed by sh_exec_minor_command_set()
+ *
+ * @param row [sh_row_t]: The row object, which holds all commands of the parsed row and its plan
+ * @param node [size_t]: The index in $row->plan of the node to execute
+ *
+ */
+bool sh_exec_plan ( const sh_row_t *row, size_t node ) {
+
+    // Vars
+    const sh_node_t *n;
+    bool result, job;
+    pid_t cpid;
+
+    for ( ;; ) {
+
+        n = row->plan + node;
+        switch ( n->op ) {
+
+            case SH_OP_SEQ:
+
+                // Sequences are right-deep, so walk them in a loop
+                sh_exec_plan( row, n->lhs );
+                node = n->rhs;
+                continue;
+
+            case SH_OP_AND:
+                if ( !sh_exec_plan( row, n->lhs ) ) return false;
+                node = n->rhs;
+                continue;
+
+            case SH_OP_OR:
+                if ( sh_exec_plan( row, n->lhs ) ) return true;
+                node = n->rhs;
+                continue;
+
+            case SH_OP_BG:
+
+                // DEBUGGING:
+                if ( SH_DBG( 1 ) )
+                    fprintf( stdout, "\t@sh_exec_plan(): running in background\n" );
+
+                // Only the main process keeps jobs
+                job = SH_PID == getpid();
+                fflush( stdout );
+
+                // Fork a child process
+                cpid = sh_fork();
+                if ( cpid < 0 ) {
+
+                    // Print error in stdout
+                    fprintf( stdout, "\t@sh_exec_plan(): &: fork failed: %s\n", strerror( errno ) );
+
+                    // Return false to inform for failure
+                    return false;
+
+                }
+
+                // Child should execute in background ( leading its own process group, if a job )
+                if ( cpid == 0 ) {
+
+                    if ( job ) setpgid( 0, 0 );
+
+                    // Execute
+                    result = sh_exec_plan( row, n->lhs );
+
+                    // Terminate child informing about execution result
+                    _exit( result ? EXIT_SUCCESS : EXIT_FAILURE );
+
+                }
+
+                // Not a job: throw child out of foreground, it should continue if stopped in previous child
+                if ( !job ) {
+                    fprintf( stdout, "[%zu] %ld\n", n->rhs, ( long ) cpid );
+                    kill( cpid, SIGTTOU );
+                    kill( cpid, SIGCONT );
+                    return true;
+                }
+
+                // Job ( set its group here too, whichever process runs first )
+                setpgid( cpid, cpid );
+                fprintf( stdout, "[%zu] %ld\n", sh_job_add( cpid, sh_job_describe( row, node ) ), ( long ) cpid );
+
+                return true;
+
+            default:
+
+                // Pipeline
+                return sh_exec_minor_command_set( row, n->lhs, n->rhs );
+
+        }
+
+    }
+
+}
+/*
+ * Execution of a command-set between '&&' or '||' or '&'
+ *
+ * When executing this encapsulated command-set, only pipes should be considered to separate commands
+ * This ensures bash-like shell behavior
+ *
+ * @param row [sh_row_t]: The row object, which holds all commands of the parsed row
+ * @param idx [size_t]: The index in $raw->cmds of the first command in command-set
+ * @param ncmds [size_t]: Number of commands in command-set
+ *
+ */
+bool sh_exec_minor_command_set ( const sh_row_t *row, size_t idx, size_t ncmds ) {
+
+    // Print formal params
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_exec_minor_command_set(): executing command-set ( from = %zu | ncmds = %zu )\n", idx,
+                 ncmds );
+
+    // Vars
+    size_t i, npipes;
+    pid_t pid;
+    bool result, direct;
+    int **pipe_channel;
+    sh_cmd_t *cmd;
+
+    /*
+     * ----------------------------
+     * Single built-in command
+     * ----------------------------
+     *
+     * A command-set of just one built-in command ( with no redirections ) is executed in this process directly:
+     * no pipes, no fork, no request to the main process. Built-in commands that must be run in the main process
+     * take this path only if this is the main process ( e.g. not a background command-set's child ).
+     *
+     */
+    if ( 1 == ncmds ) {
+
+        // Parse
+        cmd = row->cmds + idx;
+        cmd->utils->parse( cmd );
+
+        // Check command
+        if ( cmd->is_blt && ( !cmd->bltcmd->run_in_main_process || SH_PID == getpid() ) &&
+             0 == sh_cmd_lt_arg_exists( cmd ) && 0 == sh_cmd_gt_arg_exists( cmd ) ) {
+
+            // DEBUGGING:
+            if ( SH_DBG( 1 ) )
+                fprintf( stdout, "\t@sh_exec_minor_command_set(): executing built-in command in-process: %s\n",
+                         cmd->cmd );
+
+            // Execute built-in command's associated function
+            return cmd->bltcmd->exec( cmd );
+
+        }
+
+    }
+
+    /*
+     * --------------------------
+     * Creation of pipe channels
+     * --------------------------
+     *
+     * The number of pipe channels should be the same as the number of commands.
+     * In direct output mode the last command inherits shell's stdout, so its pipe channel is left NULL.
+     *
+     * Firstly, we allocate memory for the pipe channels.
+     * Then, we construct each ( using pipe() ) with checking for errors.
+     *
+     */
+
+    // Single commands always write directly to stdout, pipelines only if $SH_DIRECT_OUT is set
+    direct = 1 == ncmds || SH_CONF.direct_out;
+    npipes = direct ? ncmds - 1 : ncmds;
+
+    // Allocate $pipe_channel 's first dimension and the channels ( released with the row )
+    pipe_channel = ( int ** ) sh_arena_alloc( &SH_ARENA, ncmds * sizeof( int * ) + npipes * 2 * sizeof( int ) );
+    if ( NULL == pipe_channel ) {
+
+        // Echo error
+        fprintf( stdout, "\t@sh_exec_minor_command_set(): sh_arena_alloc for $pipe_channel failed: %s\n",
+                 strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Init pipe channels
+    for ( i = 0; i < ncmds; ++i ) *( pipe_channel + i ) = NULL;
+    for ( i = 0; i < npipes; ++i ) {
+
+        // Assign pipe channel
+        *( pipe_channel + i ) = ( int * ) ( pipe_channel + ncmds ) + 2 * i;
+
+        // Create the pipe for each channel
+        // If pipe() < 0, means that descriptors could not be initialized
+        if ( pipe( *( pipe_channel + i ) ) < 0 ) {
+
+            // Print error in stdout
+            fprintf( stdout, "\t@sh_exec_minor_command_set(): pipe() error: %s\n", strerror( errno ) );
+
+            // Close pipes created so far ( their memory is released with the row )
+            while ( i-- > 0 ) {
+                close( pipe_channel[ i ][ READ_EDGE ] );
+                close( pipe_channel[ i ][ WRITE_EDGE ] );
+            }
+
+            // Return false to inform for failure
+            return false;
+
+        }
+
+    }
+
+
+    /*
+     * ----------------------------
+     * Execution of MINOR commands
+     * ----------------------------
+     *
+     * To execute the commands in the minor command-set, we use two main processes.
+     *  - parent process:   executes the minor commands assigning the execution to a forked process per command
+     *  - child process :   listens to the READ_EDGE of the last pipe to read the final output,
+     *                      then it prints to stdout and exits
+     *
+     * In direct output mode there is no child process: the last command writes to stdout itself.
+     *
+     * Failure:
+     * In the case that a command fails ( return status non-zero ) the execution stops and parent returns FALSE.
      *
      */
-    if ( '&' == *( row->cmds + idx + ncmds - 1 )->glue_a ) {
+    pid = 0;
+    if ( !direct ) {
+
+        // Fork process ( nothing buffered should be inherited )
+        fflush( stdout );
+        pid = sh_fork();
+        if ( pid < 0 ) {
+
+            // Print error in stdout
+            fprintf( stdout, "\t@sh_exec_minor_command_set(): fork failed: %s\n", strerror( errno ) );
+
+            // Close pipes ( their memory is released with the row )
+            for ( i = 0; i < npipes; ++i ) {
+                close( pipe_channel[ i ][ READ_EDGE ] );
+                close( pipe_channel[ i ][ WRITE_EDGE ] );
+            }
+
+            // Return false to inform for failure
+            return false;
+
+        }
+
+        /* Child Process */
+        if ( pid == 0 ) {
+
+            // Execute sh_exec_response
+            sh_exec_response( ncmds, pipe_channel );
+
+            // Child collected response
+            _exit( EXIT_SUCCESS );
+
+        }
+
+    }
+
+    /* Parent Process */
+
+    // Execute MINOR command-set and get result
+    result = sh_exec_wrapper( row->cmds + idx, ncmds, pipe_channel );
+
+    // Inspect execution result
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_exec_minor_command_set(): sh_exec_wrapper() exited with status: %d\n",
+                 result ? EXIT_SUCCESS : EXIT_FAILURE );
+
+    // Wait for response collector ( do not care about return status )
+    if ( !direct ) sh_waitpid( pid, NULL );
+
+    // UPDATE: If execution fails, try searching if command was a batch file's name
+    if ( !result && SH_CONF.on_cmd_fail_search_bf ) {
+
+        // Report for redirection
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_exec_wrapper(): command failed - searching for batch file '%s'\n",
+                     ( row->cmds + idx )->cmd );
+
+        // Check as filename
+        char *fname;
+
+        // Search
+        fname = sh_file_exists( ( row->cmds + idx )->cmd );
+
+        // Check returned string
+        // If is not NULL, then a command is an existent file
+        // Execute file in batch mode and return this result
+        if ( NULL != fname ) {  // Found as filename
+
+            // Execute
+            result = mode_b( fname );
+
+            // Free resources
+            free( fname );
+
+        }
+
+    }
+
+    // Inform MAJOR about execution result
+    return result;
+
+}
+/*
+ * Execution of a minor command-set
+ * In MINOR command-set only pipes are allowed between commands
+ */
+bool sh_exec_wrapper ( sh_cmd_t *cmds, size_t ncmds, int **pd ) {
+
+    // DEBUGGING:
+    if ( SH_DBG( 2 ) ) {
+        fprintf( stdout, "\t@sh_exec_wrapper(): pipe_channel inspection start\n" );
+        sh_inspect_pipes( pd, ncmds );
+        fprintf( stdout, "\t@sh_exec_wrapper(): pipe_channel inspection stop\n" );
+    }
+
+    // Vars
+    bool result, spawn;
+    pid_t *pid;
+    size_t i;
+
+    // Init
+    // We will fork so many processes as are the commands of current MINOR
+    pid = ( pid_t * ) sh_arena_alloc( &SH_ARENA, ncmds * sizeof( pid_t ) );
+    if ( NULL == pid ) {
+
+        // Echo error
+        fprintf( stdout, "\t@sh_exec_wrapper(): sh_arena_alloc for $pid failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+    memset( pid, 0, ncmds * sizeof( pid_t ) );
+
+    result = true;      // overall result ( if any child fails, this becomes FALSE )
+    spawn = SH_CONF.spawn_mode == 1;
+
+    // Resolve commands in the parent process, so that children inherit a warm PATH index
+    sh_path_sync();
+    for ( i = 0; i < ncmds; ++i ) {
+
+        ( cmds + i )->utils->parse( cmds + i );
+        ( cmds + i )->utils->isvalid( cmds + i );
+
+    }
+
+    // Execute commands, forking each to a child process
+    for ( i = 0; i < ncmds; ++i ) {
+
+        // File nos
+        int fileno_stdin, fileno_stdout;
+
+        // Nothing buffered should be inherited or overtaken by the command's output
+        fflush( stdout );
+
+        // Spawn backend ( built-in commands need a copy of the shell, so they are always forked )
+        if ( spawn && NULL != pd && !( cmds + i )->is_blt ) {
+
+            // Spawn command with its pipe edges and redirections as file actions
+            *( pid + i ) = sh_exec_spawn( cmds, i, ncmds, pd );
+            if ( *( pid + i ) < 0 ) result = false;
+
+            // Next command
+            continue;
+
+        }
+
+        // Create a process for the command
+        *( pid + i ) = sh_fork();
+        if ( *( pid + i ) < 0 ) {
+
+            // Print error in stdout
+            fprintf( stdout, "\t@sh_exec_wrapper(): fork() error ( i = %zu ): %s\n", i, strerror( errno ) );
+
+            // Assign overall result to FALSE
+            result = false;
+
+            // Break out of loop
+            break;
+
+        }
+
+        /*
+         * New command in a new process (the child process)
+         *
+         *  input: pd[i-1][1] (instead of STDOUT_FILENO)
+         *  output: pd[i][0] (instead of STDOUT_FILENO)
+         */
+        if ( *( pid + i ) == 0 ) {
+
+            /*
+             * -----------
+             * Setup pipe
+             * -----------
+             *
+             * The pipe channel has been created and accessed @ $pipe_channel[ $pos ][ $READ_EDGE / $WRITE_EDGE ].
+             * Before executing the command, we should setup the READ / WRITE edge of its pipe channel.
+             *
+             */
+            if ( NULL != pd ) {
+
+                if ( NULL != pd ) {
+
+                    // Default output: own pipe's WRITE_EDGE or shell's stdout ( direct output mode )
+                    int fileno_pipe_out = NULL != pd[ i ] ? pd[ i ][ WRITE_EDGE ] : STDOUT_FILENO;
+
+                    // Check if command has specified input or output file(s)
+                    // For input file the arg '<' should exist in $cmd->args and a valid filename should have been given
+                    // For output file the arg '>' should exist in $cmd->args and a valid filename should have been given
+                    size_t lt_index, gt_index;
+
+                    // Input check
+                    lt_index = sh_cmd_lt_arg_exists( cmds + i );
+                    if ( lt_index > 0 && ( cmds + i )->nargs > lt_index + 1 ) {
+
+                        // Get input file's name
+                        char *fname_in;
+                        fname_in = *( ( cmds + i )->args + lt_index + 1 );
+
+                        // DEBUGGING:
+                        if ( SH_DBG( 2 ) )
+                            fprintf( stdout, "\t@sh_exec_wrapper(): '%s': input file set\n", fname_in );
+
+                        // Check if file exists
+                        FILE *fpin = fopen( fname_in, "r" );
+                        if ( NULL != fpin ) {
+
+                            // Assign file no of open file stream
+                            fileno_stdin = fileno( fpin );
+
+                            // Remove arguments relevant to this operation
+                            sh_cmd_purge_args( cmds + i, lt_index, 2 );
+
+                            // DEBUGGING:
+                            if ( SH_DBG( 2 ) )
+                                ( cmds + i )->utils->inspect( cmds + i );
+
+                        } else {
+
+                            // Fallback to default pipe's file no
+                            fileno_stdin = 0 < i ? pd[ i - 1 ][ READ_EDGE ] : STDIN_FILENO;
+
+                        }
+
+                    } else fileno_stdin = 0 < i ? pd[ i - 1 ][ READ_EDGE ] : STDIN_FILENO;
+
+                    // Output check
+                    gt_index = sh_cmd_gt_arg_exists( cmds + i );
+                    if ( gt_index > 0 && ( cmds + i )->nargs > gt_index + 1 ) {
+
+                        // Get input file's name
+                        char *fname_out;
+                        fname_out = *( ( cmds + i )->args + gt_index + 1 );
+
+                        // DEBUGGING:
+                        if ( SH_DBG( 2 ) )
+                            fprintf( stdout, "\t@sh_exec_wrapper(): '%s': output file set\n", fname_out );
+
+                        // Check if file exists
+                        FILE *fpout = fopen( fname_out, "a+" );
+                        if ( NULL == fpout ) {
+
+                            // Fallback to default pipe's file no
+                            fileno_stdout = fileno_pipe_out;
+
+                        } else {
+
+                            // Assign open file no to fpout
+                            fileno_stdout = fileno( fpout );
+
+                            // Remove arguments relevant to this operation
+                            if ( !sh_cmd_purge_args(cmds + i, gt_index, 2 ) ) {
+
+                                // DEBUGGING:
+                                if ( SH_DBG( 1 ) )
+                                    fprintf( stdout, "\t@sh_exec_wrapper(): sh_cmd_purge_args() failed\n" );
+
+                                // Fallback to default pipe's file no
+                                fileno_stdout = fileno_pipe_out;
+
+                            }
+
+                            // DEBUGGING:
+                            if ( SH_DBG( 2 ) )
+                                ( cmds + i )->utils->inspect( cmds + i );
+
+                        }
+
+                    } else fileno_stdout = fileno_pipe_out;
+
+                    // Duplicate descriptors
+                    dup2( fileno_stdin, STDIN_FILENO );
+                    dup2( fileno_stdout, STDOUT_FILENO );
+
+                    // Child: Close all descriptors
+                    for ( size_t ci = 0; ci < ncmds; ++ci ) {
+                        if ( NULL == pd[ ci ] ) continue;
+                        close( pd[ ci ][ READ_EDGE ] );
+                        close( pd[ ci ][ WRITE_EDGE ] );
+                    }
+
+                    // Check for file descriptors
+                    if ( ( 0 < i && fileno_stdin != pd[ i - 1 ][ READ_EDGE ] ) || fileno_stdin != STDIN_FILENO ) close( fileno_stdin );
+                    if ( fileno_stdout != fileno_pipe_out ) close( fileno_stdout );
+
+                }
+
+            }
+
+            // Execute command ( returns only for built-in commands or on failure )
+            result = sh_exec( cmds + i );
+
+            // Check if command is valid
+            if ( !result ) {
+
+                // If command is returned <> 0, inform to stdout
+                fprintf( stdout, "\t@sh_exec_wrapper(): %s: command failed: %s\n",
+                         ( cmds + i )->cmd, strerror( errno ) );
+
+                // Close std file streams ( as would a successful execution )
+                fclose( stdin );
+                fclose( stdout );
+
+                // If reached here..
+                _exit( EXIT_FAILURE );
+
+            }
+
+            // Command executed successfully
+            _exit( EXIT_SUCCESS );
+
+        }
+
+    }
+
+    // Parent: Close all descriptors
+    if ( NULL != pd ) {
+
+        for ( i = 0; i < ncmds; ++i ) {
+
+            if ( NULL == pd[ i ] ) continue;
+            close( pd[ i ][ READ_EDGE ] );
+            close( pd[ i ][ WRITE_EDGE ] );
+
+        }
+
+    }
+
+    // Parent: Wait for all known pids to die
+    for ( i = 0; i < ncmds; ++i ) {
+
+        // Skip commands that never started
+        if ( *( pid + i ) <= 0 ) continue;
+
+        // Get return status of dead child ( the command itself, since the child exec'd it )
+        int status;
+        sh_waitpid( *( pid + i ), &status );
+
+        // Check $status
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_exec_wrapper(): -- child [pid = %d] finished with status: %d\n", *( pid + i ),
+                     status );
+
+        // Return
+        if ( !WIFEXITED( status ) || EXIT_SUCCESS != WEXITSTATUS( status ) ) {
+
+            // DEBUGGING:
+            if ( SH_DBG( 1 ) )
+                fprintf( stdout, "\t@sh_exec_wrapper(): -- status states failure, aborting\n" );
+
+            // Assign overall result to FALSE
+            result = false;
+
+            // Exit wait loop
+            break;
+
+        }
+
+    }
+
+    return result;
+
+}
+/*
+ * Spawn a single command of a minor command-set via posix_spawn()
+ *
+ * This is the spawn backend of sh_exec_wrapper() ( see $SH_SPAWN_MODE ). No copy of the shell is made: the pipe
+ * edges and the '<' / '>' redirections that the forked child would set up are expressed as spawn file actions.
+ *
+ * @param cmds [sh_cmd_t *]: The commands of the minor command-set
+ * @param i [size_t]: The index of the command to be spawned
+ * @param ncmds [size_t]: Number of commands in command-set
+ * @param pd [int **]: The pipe channels of the command-set
+ * @return [pid_t]: The spawned process' pid or -1 on failure
+ */
+pid_t sh_exec_spawn ( sh_cmd_t *cmds, size_t i, size_t ncmds, int **pd ) {
+
+    // Vars
+    posix_spawn_file_actions_t actions;
+    sh_cmd_t *cmd;
+    const char *path;
+    const char *fname_in, *fname_out;
+    size_t lt_index, gt_index, ci;
+    pid_t pid;
+    int err;
+
+    // Init
+    cmd = cmds + i;
+    fname_in = NULL;
+    fname_out = NULL;
+
+    // Resolve command ( cached by sh_exec_wrapper() )
+    path = sh_path_lookup( cmd->cmd );
+    if ( NULL == path ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_exec_spawn(): %s: command not found\n", cmd->cmd );
+
+        // Return failure
+        return -1;
+
+    }
+
+    // Input file: only if readable ( else fallback to default pipe's edge, as the fork backend does )
+    lt_index = sh_cmd_lt_arg_exists( cmd );
+    if ( lt_index > 0 && cmd->nargs > lt_index + 1 && access( *( cmd->args + lt_index + 1 ), R_OK ) == 0 ) {
+
+        // Purging only moves pointers, the name stays in the row's buffer
+        fname_in = *( cmd->args + lt_index + 1 );
+        sh_cmd_purge_args( cmd, lt_index, 2 );
+
+    }
+
+    // Output file
+    gt_index = sh_cmd_gt_arg_exists( cmd );
+    if ( gt_index > 0 && cmd->nargs > gt_index + 1 ) {
+
+        // Purging only moves pointers, the name stays in the row's buffer
+        fname_out = *( cmd->args + gt_index + 1 );
+        if ( !sh_cmd_purge_args( cmd, gt_index, 2 ) ) {
+
+            // Fallback to default pipe's edge
+            fname_out = NULL;
+
+        }
+
+    }
+
+    // DEBUGGING:
+    if ( SH_DBG( 2 ) )
+        fprintf( stdout, "\t@sh_exec_spawn(): '%s': input: %s | output: %s\n", path,
+                 NULL != fname_in ? fname_in : "(pipe)", NULL != fname_out ? fname_out : "(pipe)" );
+
+    // Setup file actions
+    posix_spawn_file_actions_init( &actions );
+
+    // stdin: input file, previous pipe's READ_EDGE or shell's stdin
+    if ( NULL != fname_in )
+        posix_spawn_file_actions_addopen( &actions, STDIN_FILENO, fname_in, O_RDONLY, 0 );
+    else if ( 0 < i )
+        posix_spawn_file_actions_adddup2( &actions, pd[ i - 1 ][ READ_EDGE ], STDIN_FILENO );
+
+    // stdout: output file ( opened as with fopen( "a+" ) ), own pipe's WRITE_EDGE or shell's stdout
+    if ( NULL != fname_out )
+        posix_spawn_file_actions_addopen( &actions, STDOUT_FILENO, fname_out, O_RDWR | O_CREAT | O_APPEND, 0666 );
+    else if ( NULL != pd[ i ] )
+        posix_spawn_file_actions_adddup2( &actions, pd[ i ][ WRITE_EDGE ], STDOUT_FILENO );
+
+    // Close all pipe edges
+    for ( ci = 0; ci < ncmds; ++ci ) {
+        if ( NULL == pd[ ci ] ) continue;
+        posix_spawn_file_actions_addclose( &actions, pd[ ci ][ READ_EDGE ] );
+        posix_spawn_file_actions_addclose( &actions, pd[ ci ][ WRITE_EDGE ] );
+    }
+
+    // Spawn
+    err = posix_spawn( &pid, path, &actions, &SH_SPAWNATTR, cmd->args, environ );
+    if ( 0 != err ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_exec_spawn(): %s: posix_spawn failed: %s\n", cmd->cmd, strerror( err ) );
+
+        // Mark failure
+        pid = -1;
+
+    }
+
+    // Free resources
+    posix_spawn_file_actions_destroy( &actions );
+
+    return pid;
+
+}
+/*
+ * Output collector of a minor command-set
+ *
+ * Streams the last pipe's READ_EDGE to stdout as data arrives, using constant memory regardless of output's size.
+ * Data are moved with splice() ( kernel-side, no copy to user space ). If stdout cannot be spliced to ( e.g. a
+ * terminal ), falls back to read() / write() in chunks of BUF_LEN_MAX bytes.
+ */
+void sh_exec_response ( size_t ncmds, int **pd ) {
+
+    // Vars
+    size_t i;
+    ssize_t n, w, off;
+    int fd_in;
+    bool use_splice;
+    char buf[BUF_LEN_MAX];
+
+    // Close all descriptors
+    close( pd[ ncmds - 1 ][ WRITE_EDGE ] );
+    for ( i = 0; i < ncmds - 1; ++i ) {
+        close( pd[ i ][ READ_EDGE ] );
+        close( pd[ i ][ WRITE_EDGE ] );
+    }
+
+    // Init
+    fd_in = pd[ ncmds - 1 ][ READ_EDGE ];
+    use_splice = true;
+
+    // Nothing buffered should be written after the streamed data
+    fflush( stdout );
+
+    // Stream until EOF ( all writers of the last pipe are done )
+    while ( true ) {
+
+        if ( use_splice ) {
+
+            n = splice( fd_in, NULL, STDOUT_FILENO, NULL, BUF_LEN_MAX, SPLICE_F_MOVE | SPLICE_F_MORE );
+            if ( n < 0 && ( EINVAL == errno || ENOSYS == errno ) ) {
+
+                // stdout does not support splice(), continue with read() / write()
+                use_splice = false;
+                continue;
+
+            }
+
+        } else {
+
+            n = read( fd_in, buf, BUF_LEN_MAX );
+
+            // Write everything read ( write() may be partial )
+            for ( off = 0; n > 0 && off < n; off += w ) {
+
+                w = write( STDOUT_FILENO, buf + off, ( size_t ) ( n - off ) );
+                if ( w < 0 && EINTR == errno ) w = 0;
+                if ( w < 0 ) {
+                    n = -1;
+                    break;
+                }
+
+            }
+
+        }
+
+        // EOF
+        if ( 0 == n ) break;
+
+        // Error
+        if ( n < 0 ) {
+
+            // Interrupted: retry
+            if ( EINTR == errno ) continue;
+
+            // Report error
+            fprintf( stdout, "\t@sh_exec_response(): streaming output failed: %s\n", strerror( errno ) );
+
+            // Stop collecting
+            break;
+
+        }
+
+    }
+
+    // Close pipe
+    close( fd_in );
+
+    // Close stdout
+    fclose( stdout );
+
+}
+/*
+ * Executes a single command
+ *
+ * Must be called from the command's own process ( the child forked by the wrapper for this stage ).
+ * External commands replace the process image via execv(), so that their exit status reaches the wrapper's
+ * waitpid() directly. Built-in commands are executed and their result is returned.
+ * Returns only on built-in commands or on failure.
+ * Does not takes care of pipes ( it is assumed that the wrapper set the pipe channel etc. )
+ */
+bool sh_exec ( sh_cmd_t *cmd ) {
+
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_exec(): executing --%s--\n", NULL != cmd->cmd ? cmd->cmd : "(null)\n" );
+
+    // First sh_cmd_parse command ( if not parsed before )
+    cmd->utils->parse( cmd );
+
+    // Inspect command
+    if ( SH_DBG( 2 ) ) cmd->utils->inspect( cmd );
+
+    // Check if command is valid
+    if ( !cmd->utils->isvalid( cmd ) ) return false;
+
+    // Check if is built-in command
+    if ( cmd->is_blt ) return sh_exec_builtin( cmd );
+
+    // Flush anything this process still has buffered before the image is replaced
+    fflush( stdout );
+
+    // Execute shell command with args ( the path was resolved by isvalid() )
+    execv( sh_path_lookup( cmd->cmd ), cmd->args );
+
+    // If reaches here, means an error occured
+    fprintf( stdout, "\t@sh_exec(): execv returned: %s\n", strerror( errno ) );
+
+    // Return failure
+    return false;
+
+}
+/*
+ * Built-in command execution
+ *
+ * Built-in commands flagged with $run_in_main_process have to be executed on the main process.
+ * But here we reach via one of its children. Therefore, the command is sent to the main process as a request
+ * ( see sh_ipc_request() ) and this process waits for its result.
+ */
+bool sh_exec_builtin ( sh_cmd_t *cmd ) {
+
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_exec_builtin(%d): executing builtin command: %s\n", getpid(), cmd->cmd );
+
+    // Vars
+    bool result;    // the execution result
+
+    // If built-in command can be run by any process ( e.g. reading an env variable )
+    // then we should run it here
+    if ( !cmd->bltcmd->run_in_main_process || SH_PID == getpid() ) {
+
+        // Execute built-in command's associated function
+        // The struct sh_bltcmd_t defines two fields: the command name and a function
+        result = cmd->bltcmd->exec( cmd );
+
+    } else {
+
+        // else execute command in main process
+        result = sh_ipc_request( cmd );
+
+        // Inform that you' ve received response
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_exec_builtin(): main process finished executing command\n" );
+
+    }
+
+    // Return execution result
+    return result;
+
+}
+
+/*
+ * ----------------
+ * Operation Modes
+ * ----------------
+ *
+ * 1 ) Interactive Mode
+ *    The user inputs single-row commands, the program parses them and executes them in order.
+ *
+ * 2 ) Batch Mode
+ *    The user inputs a filename that contains a batch of single-row commands.
+ *    The program parses and executes each row as in interactive mode
+ *
+ * 3 ) Mixed Mode
+ *    The user inputs single-row commands that may contain just the batch file's name.
+ *    In that case the program switches to batchmode and after execution of file's commands, returns to interactive mode.
+ *
+ */
+/*
+ *  mode_i() - Interactive Mode
+ *
+ *  In interactive mode, user enters an one-line command.
+ *  The program reads the raw input and parses it to commands to be executed.
+ *
+ *  @param [bool] mode_m: enable / disable mixed mode
+ *  @return [bool]: the overall execution result of all commands given during interactive mode
+ *
+ */
+bool mode_i ( bool mode_m ) {
+
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, ":| Switched to interactive mode |:\n" );
+
+    // Vars
+    char *raw, *prompt, *fname;
+    bool result_partial, result_overall;
+
+    // Init
+    raw = ( char * ) calloc( ROW_LEN_MAX, sizeof( char ) );
+    if ( NULL == raw ) {
+
+        // Echo error
+        fprintf( stdout, "\t@mode_i(): calloc for $raw failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+
+    prompt = ( char * ) calloc( strlen( PROMPT_MESSAGE ) + 1, sizeof( char ) );
+    if ( NULL == prompt ) {
+
+        // Echo error
+        fprintf( stdout, "\t@mode_i(): calloc for $prompt failed: %s\n", strerror( errno ) );
+
+        // Free resources
+        free( raw );
+
+        // Return failure
+        return false;
+
+    }
+
+    result_overall = true;
+
+    // Create prompt
+    strcat( prompt, PROMPT_MESSAGE );   // we create prompt message in this way so as for it to be flexible
+
+    // Main shell loop
+    do {
+
+        // Report finished background jobs
+        sh_job_notify();
+
+        // Print prompt
+        fprintf( stdout, "%s> ~%s$ ", prompt,
+                 SH_CONF.show_wd || strcmp( SH_WD, SH_WD_I ) != 0 ? SH_WD : "" );
+
+        // Clear the raw buffer
+        memset( raw, '\0', ROW_LEN_MAX );
+
+        // Get input ( serving built-in command requests of background command-sets meanwhile )
+        fflush( stdout );
+        sh_wait_input( STDIN_FILENO );
+        fgets( raw, ROW_LEN_MAX, stdin );
+
+        // Remove <lf>
+        *( raw + strlen( raw ) - 1 ) = '\0';
+
+        // Check for exit
+        if ( sh_quit( raw, strlen( raw ) ) ) break;
+
+        // Raise executing flag
+        SH_EXECUTING = true;
+
+        // Drop SH_FORCE_QUIT flag
+        // needs be off before every command's execution
+        SH_FORCE_QUIT = false;
+
+        // Parse & execute single-row commands
+        // Check if in mixed mode and file is batch file
+        if ( mode_m ) {
+
+            // Check if filename exists
+            fname = mode_m ? sh_file_exists( raw ) : NULL;
+
+            // Check fname
+            if ( NULL != fname ) {
+
+                // If TRUE, ask if should execute file name
+                fprintf( stdout, "\t@mode_i(): %s: execute batch file instead of command-set? [y|N]: ", fname );
+
+                // Get answer
+                char tempptr[ROW_LEN_MAX];
+                fgets( tempptr, ROW_LEN_MAX, stdin );
+
+                // Check answer
+                if ( 'y' == *tempptr || 'Y' == *tempptr ) {
+
+                    // Execute
+                    result_partial = mode_b( fname );
+
+                    // Free resources
+                    free( fname );
+
+                } else result_partial = sh_parse_exec_row( raw, strlen( raw ) );
+
+            } else result_partial = sh_parse_exec_row( raw, strlen( raw ) );
+
+        } else result_partial = sh_parse_exec_row( raw, strlen( raw ) );
+
+        // Drop executing flag
+        SH_EXECUTING = false;
+
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@mode_i(): command execution finished\n" );
+
+        // Check result
+        if ( !result_partial ) {
+
+            // Print error
+            if ( SH_DBG( 1 ) )
+                fprintf( stdout, "\t@mode_i(): error executing command-set: '%s'\n", raw );
+
+            // Assign to result_overall
+            if ( result_overall ) result_overall = false;
 
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_exec_major_command_set(): running in background\n" );
+            // Check abort
+            if ( SH_CONF.on_row_err_abrt ) break;
+
+        }
+
+    } while ( !SH_QUIT );
+
+    // Free resources
+    free( raw );
+    free( prompt );
+
+    // Return
+    return result_overall;
+}
+
+/*
+ * Close a worker's outputs ( see sh_batch_fork() )
+ */
+static void sh_batch_drop ( int *out ) {
+
+    close( out[ 0 ] );
+    close( out[ 1 ] );
+
+}
+/*
+ * Fork a worker that executes a batch file's row, with its stdout and stderr redirected to temporary files
+ *
+ * A failing row's error is reported in its own output, so that it is emitted along with it.
+ *
+ * @param row [string]: The row ( not NULL-terminated )
+ * @param len [size_t]: Length of $row
+ * @param out [int[2]]: Set to the worker's stdout, stderr ( to be passed to sh_batch_emit() )
+ * @return [pid_t]: The worker's pid or -1 on failure ( reported )
+ */
+static pid_t sh_batch_fork ( const char *row, size_t len, int *out ) {
+
+    // Vars
+    pid_t pid;
+    bool result;
+
+    // Create worker's outputs
+    out[ 0 ] = sh_tmpfd();
+    out[ 1 ] = out[ 0 ] < 0 ? -1 : sh_tmpfd();
+    if ( out[ 1 ] < 0 ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_batch_fork(): temporary file could not be created: %s\n", strerror( errno ) );
+
+        // Return failure
+        if ( out[ 0 ] >= 0 ) close( out[ 0 ] );
+        return -1;
+
+    }
+
+    // Fork worker ( nothing buffered should be inherited )
+    fflush( stdout );
+    pid = sh_fork();
+    if ( pid < 0 ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_batch_fork(): fork failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        sh_batch_drop( out );
+        return -1;
+
+    }
+
+    // Worker executes row, writing to its outputs
+    if ( 0 == pid ) {
+
+        fflush( stderr );
+        dup2( out[ 0 ], STDOUT_FILENO );
+        dup2( out[ 1 ], STDERR_FILENO );
+        sh_batch_drop( out );
+
+        // Parse & execute single-row commands
+        result = sh_parse_exec_row( row, len );
+        if ( !result )
+            fprintf( stdout, "\t@mode_b(): error executing command-set: '%.*s'\n", ( int ) len, row );
+
+        // Terminate informing about execution result
+        fflush( stdout );
+        _exit( result ? EXIT_SUCCESS : EXIT_FAILURE );
+
+    }
+
+    return pid;
+
+}
+/*
+ * Copy a finished worker's outputs to stdout, stderr and close them
+ *
+ * @param out [int[2]]: The worker's stdout, stderr
+ * @param buf [string]: A buffer of BUF_LEN_MAX bytes
+ */
+static void sh_batch_emit ( int *out, char *buf ) {
+
+    // Vars
+    ssize_t n;
+    int i;
+
+    // Nothing buffered should be written after
+    fflush( stdout );
+    fflush( stderr );
+
+    for ( i = 0; i < 2; ++i )
+        if ( lseek( out[ i ], 0, SEEK_SET ) == 0 )
+            while ( ( n = read( out[ i ], buf, BUF_LEN_MAX ) ) > 0 )
+                if ( write( STDOUT_FILENO + i, buf, ( size_t ) n ) != n ) break;
+    sh_batch_drop( out );
+
+}
+/*
+ * Parallel execution of a batch file's rows ( -j )
+ *
+ * Each row is executed by a forked worker, with its stdout redirected to a temporary file. Up to $njobs workers run
+ * at once, and up to 4 * $njobs rows may wait for their output to be emitted. Outputs are copied to stdout in file
+ * order, so the output is the same as in sequential execution, only written one row at a time.
+ *
+ * Rows should be independent: built-in commands that change the shell's state are requested from the main process
+ * ( as in background command-sets ), so they do not affect rows already running. On failure, when
+ * $SH_ON_FROW_ERR_ABRT is set, no more rows are started; running rows complete.
+ *
+ * @param rd [sh_reader_t]: The batch file's reader
+ * @param njobs [size_t]: Maximum number of workers
+ * @param inc [sh_inc_t]: The incremental execution's journal ( -i, NULL if not given )
+ * @param ck [sh_ckpt_t]: The checkpoint journal
+ * @return [bool]: TRUE if all rows executed successfully, FALSE otherwise
+ */
+bool sh_batch_parallel ( sh_reader_t *rd, size_t njobs, sh_inc_t *inc, sh_ckpt_t *ck ) {
+
+    // Vars
+    sh_brow_t *rows, *brow;
+    size_t nrows, head, tail, nrun, i, len, fp, line;
+    const char *row;
+    char *buf;
+    bool result_overall, stop;
+    pid_t pid;
+    int status;
+
+    // Init
+    nrows = 4 * njobs;
+    rows = ( sh_brow_t * ) calloc( nrows, sizeof( sh_brow_t ) );
+    buf = ( char * ) malloc( BUF_LEN_MAX );
+    if ( NULL == rows || NULL == buf ) {
+
+        // Echo error
+        fprintf( stdout, "\t@sh_batch_parallel(): calloc for $rows failed: %s\n", strerror( errno ) );
+
+        // Free resources
+        free( rows );
+        free( buf );
+
+        // Return failure
+        return false;
+
+    }
+
+    // Rows [ $head, $tail ) have been started and their output is not emitted yet ( $rows is a ring )
+    head = tail = nrun = line = 0;
+    result_overall = true;
+    stop = false;
+
+    for ( ;; ) {
+
+        // Start rows while a worker and a row slot are free
+        while ( !stop && nrun < njobs && tail - head < nrows ) {
+
+            // Get row ( at end of input or at exit just wait for the running ones )
+            row = sh_reader_next( rd, &len );
+            if ( NULL == row || sh_quit( row, len ) ) {
+                stop = true;
+                break;
+            }
+            line++;
+
+            // Empty rows and comments need no worker ( nor rows that succeeded before or unchanged since last run )
+            for ( i = 0; i < len && isspace( ( unsigned char ) *( row + i ) ); ++i );
+            if ( i == len || ( '#' == *( row + i ) && NULL == inc ) ) continue;
+            if ( sh_ckpt_skip( ck, line - 1, row, len ) ) continue;
+            fp = 0;
+            if ( NULL != inc && sh_inc_skip( inc, row, len, &fp ) ) {
+                if ( 0 != fp ) sh_ckpt_done( ck, line - 1, true );
+                continue;
+            }
+
+            // Fork worker
+            brow = rows + tail % nrows;
+            brow->fp = fp;
+            brow->line = line - 1;
+            brow->pid = sh_batch_fork( row, len, brow->out );
+            if ( brow->pid < 0 ) {
+
+                // Stop starting rows
+                result_overall = false;
+                stop = true;
+                break;
+
+            }
+
+            brow->done = false;
+            tail++;
+            nrun++;
+
+        }
+
+        // Emit outputs of finished rows, in order
+        for ( ; head < tail && ( rows + head % nrows )->done; head++ ) {
+
+            brow = rows + head % nrows;
+            if ( !brow->ok ) result_overall = false;
+            else if ( NULL != inc ) sh_inc_done( inc, brow->fp );
+            sh_batch_emit( brow->out, buf );
+            sh_ckpt_done( ck, brow->line, brow->ok );
+
+        }
+
+        // All done
+        if ( 0 == nrun && stop ) break;
+        if ( 0 == nrun ) continue;
+
+        // Wait for any worker ( serving built-in command requests meanwhile )
+        pid = sh_waitpid( -1, &status );
+        if ( pid < 0 ) {
+
+            // Report error
+            fprintf( stdout, "\t@sh_batch_parallel(): waitpid failed: %s\n", strerror( errno ) );
+
+            // Running rows are lost ( their outputs are dropped )
+            for ( ; head < tail; head++ ) sh_batch_drop( ( rows + head % nrows )->out );
+            result_overall = false;
+            break;
+
+        }
+
+        // Find its row
+        for ( i = head; i < tail && ( rows + i % nrows )->pid != pid; ++i );
+        if ( i == tail ) {
+            sh_job_update( pid, status );
+            continue;
+        }
+
+        brow = rows + i % nrows;
+        brow->done = true;
+        brow->ok = WIFEXITED( status ) && EXIT_SUCCESS == WEXITSTATUS( status );
+        nrun--;
+
+        // Check abort ( or exit requested by a row )
+        if ( ( !brow->ok && SH_CONF.on_frow_err_abrt ) || SH_QUIT ) stop = true;
+
+    }
+
+    // Free resources
+    free( rows );
+    free( buf );
+
+    // Return result of whole file execution
+    return result_overall;
+
+}
+/*
+ * ---------------
+ * Batch file DAG
+ * ---------------
+ *
+ * Rows of a batch file may declare dependencies in the comments that precede them:
+ *
+ *      # label: build
+ *      make all
+ *      # after: build
+ *      make test
+ *
+ * A label names the next row; an 'after:' lists labels ( separated by spaces or commas ) of rows that must have
+ * succeeded before the next row starts. Labels must be defined before they are used, so the file order is always
+ * a valid order ( batch files run from a row still run sequentially ). Rows with no 'after:' have no prerequisites.
+ *
+ * The main process schedules rows as workers ( see sh_batch_fork() ) as soon as all their prerequisites succeeded.
+ * Rows depending, directly or not, on a failed row are skipped. Outputs are emitted as rows finish.
+ *
+ */
+/*
+ * Match a directive in a comment row
+ *
+ * @param row [string]: The row ( not NULL-terminated )
+ * @param len [size_t]: Length of $row
+ * @param key [string]: The directive, e.g. "after:"
+ * @param val [string]: Set to the directive's value ( slice of $row )
+ * @param vlen [size_t]: Set to the length of $val
+ * @return [bool]: TRUE if $row is a comment holding directive $key, FALSE otherwise
+ */
+static bool sh_batch_directive ( const char *row, size_t len, const char *key, const char **val, size_t *vlen ) {
+
+    // Vars
+    size_t i, klen;
+
+    // Skip spaces, '#', spaces
+    klen = strlen( key );
+    for ( i = 0; i < len && isspace( ( unsigned char ) *( row + i ) ); ++i );
+    if ( i == len || '#' != *( row + i++ ) ) return false;
+    for ( ; i < len && isspace( ( unsigned char ) *( row + i ) ); ++i );
+
+    // Match key
+    if ( len - i < klen || strncmp( row + i, key, klen ) != 0 ) return false;
+
+    *val = row + i + klen;
+    *vlen = len - i - klen;
+    return true;
+
+}
+/*
+ * Check if a batch file declares any dependency ( only mapped files are checked, without reading their rows )
+ */
+static bool sh_batch_has_deps ( const sh_reader_t *rd ) {
+
+    // Vars
+    const char *hit, *end, *row;
+    const char *val;
+    size_t vlen;
+
+    if ( !rd->map ) return false;
+
+    // Search 'after:', then check that it is a directive
+    end = rd->buf + rd->end;
+    for ( hit = rd->buf; NULL != ( hit = ( const char * ) memmem( hit, ( size_t ) ( end - hit ), "after:", 6 ) ); hit += 6 ) {
+
+        row = ( const char * ) memrchr( rd->buf, '\n', ( size_t ) ( hit - rd->buf ) );
+        row = NULL == row ? rd->buf : row + 1;
+        if ( sh_batch_directive( row, ( size_t ) ( hit - row ) + 6, "after:", &val, &vlen ) ) return true;
+
+    }
+
+    return false;
+
+}
+/*
+ * Find a labelled row
+ *
+ * @param slots [size_t]: The labels' hash table ( 1 + row index, 0 if free, power of 2 number of slots )
+ * @param nslots [size_t]: Number of slots
+ * @return [size_t *]: The row's slot, or the free slot the label should be inserted at
+ */
+static size_t *sh_batch_label ( const sh_dagrow_t *rows, size_t *slots, size_t nslots, const char *label,
+                                size_t llen ) {
+
+    // Vars
+    size_t i;
+    const sh_dagrow_t *row;
+
+    // Linear probing ( the table is never full )
+    for ( i = sh_plan_hash( label, llen ) & ( nslots - 1 ); 0 != *( slots + i ); i = ( i + 1 ) & ( nslots - 1 ) ) {
+        row = rows + *( slots + i ) - 1;
+        if ( row->llen == llen && memcmp( row->label, label, llen ) == 0 ) break;
+    }
+
+    return slots + i;
+
+}
+/*
+ * Skip a row and, transitively, all rows depending on it
+ *
+ * @param stack [size_t]: Room for one index per dependency
+ * @return [size_t]: Number of rows skipped
+ */
+static size_t sh_batch_skip ( sh_dagrow_t *rows, const size_t *succs, size_t *stack, size_t idx ) {
+
+    // Vars
+    size_t n, nskip, i;
+    sh_dagrow_t *row;
+
+    // Init
+    n = nskip = 0;
+    *( stack + n++ ) = idx;
+
+    while ( n > 0 ) {
+
+        row = rows + *( stack + --n );
+        if ( 'w' != row->state ) continue;
+
+        // Skip
+        row->state = 's';
+        nskip++;
+        fprintf( stdout, "\t@mode_b(): skipping row ( a prerequisite failed ): '%.*s'\n", ( int ) row->len, row->raw );
+
+        // Then its successors
+        for ( i = 0; i < row->nsucc; ++i ) *( stack + n++ ) = *( succs + row->succ + i );
+
+    }
+
+    return nskip;
+
+}
+/*
+ * Grow an array of $size bytes items to hold at least $n items
+ *
+ * @return [bool]: FALSE if allocation failed ( the array is left untouched ), TRUE otherwise
+ */
+static bool sh_batch_grow ( void **arr, size_t *cap, size_t n, size_t size ) {
+
+    // Vars
+    void *tmp;
+    size_t ncap;
+
+    if ( n <= *cap ) return true;
+    for ( ncap = 0 == *cap ? 256 : *cap; ncap < n; ncap *= 2 );
+    tmp = realloc( *arr, ncap * size );
+    if ( NULL == tmp ) {
+
+        // Report error
+        fprintf( stdout, "\t@sh_batch_grow(): realloc failed: %s\n", strerror( errno ) );
+
+        // Return failure
+        return false;
+
+    }
+    *arr = tmp;
+    *cap = ncap;
+
+    return true;
+
+}
+/*
+ * Load a batch file's rows, their labels and their dependencies
+ *
+ * @param rows [sh_dagrow_t *]: Set to the rows ( to be freed )
+ * @param nrows [size_t]: Set to the number of rows
+ * @param edges [size_t *]: Set to the dependencies, as pairs of row indexes: prerequisite, dependent ( to be freed )
+ * @param nedges [size_t]: Set to the number of dependencies
+ * @return [bool]: FALSE if a directive is invalid or allocation failed ( reported ), TRUE otherwise
+ */
+static bool sh_batch_load ( sh_reader_t *rd, sh_dagrow_t **rows, size_t *nrows, size_t **edges, size_t *nedges ) {
+
+    // Vars
+    sh_dagrow_t *drow;
+    size_t *slots, *slot, *tmp;
+    size_t cap, ecap, nslots, nlabels, len, vlen, llen, i, j;
+    size_t line;
+    const char *row, *val, *label;
+    bool ok;
+
+    // Init
+    *rows = NULL;
+    *edges = NULL;
+    *nrows = *nedges = cap = ecap = nlabels = llen = line = 0;
+    label = NULL;
+    nslots = 64;
+    ok = NULL != ( slots = ( size_t * ) calloc( nslots, sizeof( size_t ) ) );
+
+    for ( ; ok && NULL != ( row = sh_reader_next( rd, &len ) ); line++ ) {
+
+        // Rows after an exit are not executed
+        if ( sh_quit( row, len ) ) break;
+
+        // A label names the next row
+        if ( sh_batch_directive( row, len, "label:", &val, &vlen ) ) {
+
+            for ( ; vlen > 0 && isspace( ( unsigned char ) *val ); ++val, --vlen );
+            for ( ; vlen > 0 && isspace( ( unsigned char ) *( val + vlen - 1 ) ); --vlen );
+            label = 0 == vlen ? NULL : val;
+            llen = vlen;
+            continue;
+
+        }
+
+        // Prerequisites of the next row
+        if ( sh_batch_directive( row, len, "after:", &val, &vlen ) ) {
+
+            for ( i = 0; ok && i < vlen; i = j ) {
+
+                // Next name
+                for ( ; i < vlen && ( isspace( ( unsigned char ) *( val + i ) ) || ',' == *( val + i ) ); ++i );
+                for ( j = i; j < vlen && !isspace( ( unsigned char ) *( val + j ) ) && ',' != *( val + j ); ++j );
+                if ( i == j ) break;
+
+                // Find its row
+                slot = sh_batch_label( *rows, slots, nslots, val + i, j - i );
+                if ( 0 == *slot ) {
+
+                    // Report error
+                    fprintf( stdout, "\t@mode_b(): after: unknown label '%.*s' ( labels must be defined before use )\n",
+                             ( int ) ( j - i ), val + i );
+
+                    ok = false;
+                    break;
+
+                }
+
+                // Add dependency of the next row
+                ok = sh_batch_grow( ( void ** ) edges, &ecap, *nedges + 2, sizeof( size_t ) );
+                if ( ok ) {
+                    *( *edges + ( *nedges )++ ) = *slot - 1;
+                    *( *edges + ( *nedges )++ ) = *nrows;
+                }
+
+            }
+            continue;
+
+        }
+
+        // Empty rows and comments are not executed
+        for ( i = 0; i < len && isspace( ( unsigned char ) *( row + i ) ); ++i );
+        if ( i == len || '#' == *( row + i ) ) continue;
+
+        // Add row
+        ok = sh_batch_grow( ( void ** ) rows, &cap, *nrows + 1, sizeof( sh_dagrow_t ) );
+        if ( !ok ) break;
+        drow = *rows + *nrows;
+        memset( drow, 0, sizeof( sh_dagrow_t ) );
+        drow->raw = row;
+        drow->len = len;
+        drow->line = line;
+        drow->state = 'w';
+
+        // Add its label
+        if ( NULL != label ) {
+
+            drow->label = label;
+            drow->llen = llen;
+            slot = sh_batch_label( *rows, slots, nslots, label, llen );
+            if ( 0 != *slot ) {
+
+                // Report error
+                fprintf( stdout, "\t@mode_b(): label: '%.*s' defined twice\n", ( int ) llen, label );
+
+                ok = false;
+                break;
+
+            }
+            *slot = *nrows + 1;
+            nlabels++;
+            label = NULL;
+
+            // Grow labels' table ( load factor at most 1/2 )
+            if ( 2 * nlabels > nslots ) {
+
+                tmp = ( size_t * ) calloc( 2 * nslots, sizeof( size_t ) );
+                if ( NULL == tmp ) {
+
+                    // Report error
+                    fprintf( stdout, "\t@sh_batch_load(): calloc for $slots failed: %s\n", strerror( errno ) );
+
+                    ok = false;
+                    break;
+
+                }
+                for ( i = 0; i < nslots; ++i )
+                    if ( 0 != *( slots + i ) ) {
+                        drow = *rows + *( slots + i ) - 1;
+                        *sh_batch_label( *rows, tmp, 2 * nslots, drow->label, drow->llen ) = *( slots + i );
+                    }
+                free( slots );
+                slots = tmp;
+                nslots *= 2;
+
+            }
+
+        }
+        ( *nrows )++;
+
+    }
+
+    // Drop dependencies of a missing last row
+    while ( ok && *nedges > 0 && *( *edges + *nedges - 1 ) == *nrows ) *nedges -= 2;
+
+    // Free resources
+    if ( NULL == slots ) fprintf( stdout, "\t@sh_batch_load(): calloc for $slots failed: %s\n", strerror( errno ) );
+    free( slots );
+    if ( !ok ) {
+        free( *rows );
+        free( *edges );
+        *rows = NULL;
+        *edges = NULL;
+    }
 
-        // Inform before leaving foreground
-        fprintf( stdout, "[%zu] %ld\n", ncmds, ( long ) getpid() );
+    return ok;
 
-        // Fork a child process
-        cpid = fork();
-        if ( cpid < 0 ) {
+}
+/*
+ * Dependency-aware execution of a batch file's rows ( see Batch file DAG )
+ *
+ * @param rd [sh_reader_t]: The batch file's reader ( mapped, rows are kept as slices of it )
+ * @param njobs [size_t]: Maximum number of workers
+ * @param ck [sh_ckpt_t]: The checkpoint journal
+ * @return [bool]: TRUE if all rows executed successfully, FALSE otherwise ( also if a directive is invalid )
+ */
+bool sh_batch_dag ( sh_reader_t *rd, size_t njobs, sh_ckpt_t *ck ) {
 
-            // Print error in stdout
-            fprintf( stdout, "\t@sh_exec_major_command_set(): &: fork failed: %s\n", strerror( errno ) );
+    // Vars
+    sh_dagrow_t *rows, *drow;
+    size_t *edges, *succs, *ready, *run, *stack;
+    size_t nrows, nedges, nready, rhead, nrun, ndone, i, j;
+    char *buf;
+    bool result_overall, stop;
+    pid_t pid;
+    int status;
 
-            // Return false to inform for failure
-            return false;
+    // Load rows
+    if ( !sh_batch_load( rd, &rows, &nrows, &edges, &nedges ) ) return false;
 
-        }
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_batch_dag(): %zu rows, %zu dependencies, %zu workers\n", nrows, nedges / 2, njobs );
 
-        // Child should execute in background
-        if ( cpid == 0 ) {
+    // Init ( $ready is a queue of rows that may start, $run holds the running ones )
+    succs = ( size_t * ) malloc( ( nedges / 2 + 1 ) * sizeof( size_t ) );
+    stack = ( size_t * ) malloc( ( nedges / 2 + 1 ) * sizeof( size_t ) );
+    ready = ( size_t * ) malloc( ( nrows + 1 ) * sizeof( size_t ) );
+    run = ( size_t * ) malloc( njobs * sizeof( size_t ) );
+    buf = ( char * ) malloc( BUF_LEN_MAX );
+    if ( NULL == succs || NULL == stack || NULL == ready || NULL == run || NULL == buf ) {
 
-            // Execute
-            result = sh_exec_minor_command_set( row, from, ncmds );
+        // Echo error
+        fprintf( stdout, "\t@sh_batch_dag(): malloc failed: %s\n", strerror( errno ) );
 
-            // Terminate child informing about execution result
-            _exit( result ? EXIT_SUCCESS : EXIT_FAILURE );
+        // Free resources
+        free( rows );
+        free( edges );
+        free( succs );
+        free( stack );
+        free( ready );
+        free( run );
+        free( buf );
 
-            // Parent should put child in background and force it to execute
-        } else {
+        // Return failure
+        return false;
 
-            // Throw child out of foreground
-            kill( cpid, SIGTTOU );
+    }
 
-            // Child should continue if stopped in previous child
-            kill( cpid, SIGCONT );
+    // Successors of each row, grouped by row ( counting sort of the dependencies )
+    for ( i = 0; i < nedges; i += 2 ) {
+        ( rows + *( edges + i ) )->nsucc++;
+        ( rows + *( edges + i + 1 ) )->nwait++;
+    }
+    for ( i = 1; i < nrows; ++i ) ( rows + i )->succ = ( rows + i - 1 )->succ + ( rows + i - 1 )->nsucc;
+    for ( i = 0; i < nedges; i += 2 ) *( succs + ( rows + *( edges + i ) )->succ++ ) = *( edges + i + 1 );
+    for ( i = 0; i < nrows; ++i ) ( rows + i )->succ -= ( rows + i )->nsucc;
+    free( edges );
 
-        }
+    // Rows that succeeded before ( --resume ) are done, releasing their successors ( file order is topological )
+    nready = rhead = nrun = ndone = 0;
+    for ( i = 0; i < nrows; ++i ) {
 
-        return true;
+        drow = rows + i;
+        if ( !sh_ckpt_skip( ck, drow->line, drow->raw, drow->len ) ) continue;
+        drow->state = 'o';
+        ndone++;
+        for ( j = 0; j < drow->nsucc; ++j ) ( rows + *( succs + drow->succ + j ) )->nwait--;
 
     }
 
-    /*
-     * 1) Split row execution to command-sets
-     * Search $row->cmds until an end command-set delimiter is found ('&&' or '||')
-     *
-     * 2) Decide how to execute command-sets
-     * The execution of consecutive command-sets follows these rules:
-     *  - if split by '&&', they should be executed sequentially, only if previous command-set succeeded
-     *  - if split by '||', they should be executed sequentially, only if previous command-set failed
-     *
-     */
-    for ( i = idx; i < idx + ncmds; ++i, ++mcmds ) {
+    // Rows with no prerequisites may start, in file order
+    for ( i = 0; i < nrows; ++i )
+        if ( 0 == ( rows + i )->nwait && 'w' == ( rows + i )->state ) *( ready + nready++ ) = i;
+
+    result_overall = true;
+    stop = false;
+    while ( ndone < nrows ) {
 
-        // Check @row->cmds[i] 's glue_a if it matches any of the end delimiters
-        if ( !strncmp( ( row->cmds + i )->glue_a, "||", 2 ) ) {
+        // Start ready rows while a worker is free
+        while ( !stop && nrun < njobs && rhead < nready ) {
 
-            // Command-set end found: '||'
-            result = sh_exec_minor_command_set( row, from, mcmds );
+            drow = rows + *( ready + rhead++ );
+            drow->pid = sh_batch_fork( drow->raw, drow->len, drow->out );
+            if ( drow->pid < 0 ) {
 
-            // Check $result
-            // If $result is TRUE, then no need to execute next sub-command-set
-            // Else, continue
-            if ( !result && result_ov ) result_ov = false;
-            if ( result ) {
-                result_ov = true;
+                // Stop starting rows
+                result_overall = false;
+                stop = true;
                 break;
+
             }
+            drow->state = 'r';
+            *( run + nrun++ ) = ( size_t ) ( drow - rows );
 
-            // Reset $from, $mcmds
-            from = i + 1;
-            mcmds = 0;
+        }
+
+        // Nothing running and nothing may start
+        if ( 0 == nrun ) break;
 
-        } else if ( !strncmp( ( row->cmds + i )->glue_a, "&&", 2 ) ) {
+        // Wait for any worker ( serving built-in command requests meanwhile )
+        pid = sh_waitpid( -1, &status );
+        if ( pid < 0 ) {
+
+            // Report error
+            fprintf( stdout, "\t@sh_batch_dag(): waitpid failed: %s\n", strerror( errno ) );
 
-            // Command-set end found: '&&'
-            result = sh_exec_minor_command_set( row, from, mcmds );
+            // Running rows are lost ( their outputs are dropped )
+            for ( i = 0; i < nrun; ++i ) sh_batch_drop( ( rows + *( run + i ) )->out );
+            result_overall = false;
+            break;
 
-            // Check $result
-            // If $result is FALSE, return from major command-set with FALSE
-            // Else, continue
-            if ( !result && result_ov ) result_ov = false;
-            if ( !result ) break;
+        }
 
-            // Reset $from, $mcmds
-            from = i + 1;
-            mcmds = 0;
+        // Find its row
+        for ( i = 0; i < nrun && ( rows + *( run + i ) )->pid != pid; ++i );
+        if ( i == nrun ) {
+            sh_job_update( pid, status );
+            continue;
+        }
+        drow = rows + *( run + i );
+        *( run + i ) = *( run + --nrun );
+        ndone++;
 
-        } else if ( i == idx + ncmds - 1 ) {
+        // Emit its output
+        sh_batch_emit( drow->out, buf );
+        drow->state = WIFEXITED( status ) && EXIT_SUCCESS == WEXITSTATUS( status ) ? 'o' : 'f';
+        sh_ckpt_done( ck, drow->line, 'o' == drow->state );
 
-            // Command-set end found: '&&'
-            result = sh_exec_minor_command_set( row, from, mcmds );
+        // Release its successors, or skip them
+        for ( i = 0; i < drow->nsucc; ++i ) {
 
-            // Check $result
-            // If $result is FALSE, return from major command-set with FALSE
-            // Else, continue
-            if ( !result && result_ov ) result_ov = false;
+            if ( 'o' != drow->state ) ndone += sh_batch_skip( rows, succs, stack, *( succs + drow->succ + i ) );
+            else if ( 0 == --( rows + *( succs + drow->succ + i ) )->nwait &&
+                      'w' == ( rows + *( succs + drow->succ + i ) )->state )
+                *( ready + nready++ ) = *( succs + drow->succ + i );
 
-            // Reset $from, $mcmds
-            from = i + 1;
-            mcmds = 0;
+        }
 
+        // Check abort ( or exit requested by a row )
+        if ( 'o' != drow->state ) {
+            result_overall = false;
+            if ( SH_CONF.on_frow_err_abrt ) stop = true;
         }
+        if ( SH_QUIT ) stop = true;
 
     }
 
-    // Return the overall result of the major command-set 's execution
-    return result_ov;
+    // Rows not executed after a stop
+    if ( ndone < nrows ) result_overall = false;
+
+    // Free resources
+    free( rows );
+    free( succs );
+    free( stack );
+    free( ready );
+    free( run );
+    free( buf );
+
+    // Return result of whole file execution
+    return result_overall;
 
 }
 /*
- * Execution of a command-set between '&&' or '||' or '&'
+ * ------------------------------
+ * Incremental batch execution
+ * ------------------------------
  *
- * When executing this encapsulated command-set, only pipes should be considered to separate commands
- * This ensures bash-like shell behavior
+ * With -i, a batch file's rows that succeeded in the last run are skipped if nothing they depend on has changed.
+ * Rows may declare the files they read in the comments that precede them:
  *
- * @param row [sh_row_t]: The row object, which holds all commands of the parsed row
- * @param idx [size_t]: The index in $raw->cmds of the first command in command-set
- * @param ncmds [size_t]: Number of commands in command-set
+ *      # inputs: src/main.c, include/main.h
+ *      gcc -c src/main.c -o main.o
+ *
+ * A row's fingerprint hashes its trimmed text, the working directory and the stat() of each declared input ( device,
+ * inode, size, modification and change times ), so that an edited row, or a touched input, runs again. Fingerprints
+ * of succeeded rows are written to a journal next to the batch file ( INC_JOURNAL_EXT ) when the run ends.
+ *
+ * Rows with built-ins that change the shell's state ( run_in_main_process, e.g. cd, set ) always run, as later rows
+ * depend on them. So do rows with a missing input.
  *
  */
-bool sh_exec_minor_command_set ( const sh_row_t *row, size_t idx, size_t ncmds ) {
+/*
+ * Fold a value into a fingerprint
+ */
+static size_t sh_inc_mix ( size_t fp, size_t val ) {
 
-    // Print formal params
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, "\t@sh_exec_minor_command_set(): executing command-set ( from = %zu | ncmds = %zu )\n", idx,
-                 ncmds );
+    fp = ( fp ^ val ) * 1099511628211UL;
+    return fp ^ ( fp >> 32 );
+
+}
+/*
+ * Find a fingerprint of the last run
+ *
+ * @return [size_t *]: Its slot, or the free slot it should be inserted at
+ */
+static size_t *sh_inc_slot ( const sh_inc_t *inc, size_t fp ) {
 
     // Vars
     size_t i;
-    pid_t pid;
-    bool result;
-    int **pipe_channel;
-
-    /*
-     * --------------------------
-     * Creation of pipe channels
-     * --------------------------
-     *
-     * The number of pipe channels should be the same as the number of commands.
-     *
-     * Firstly, we allocate memory for the pipe channels.
-     * Then, we construct each ( using pipe() ) with checking for errors.
-     *
-     */
 
-    // Allocate $pipe_channel 's first dimension
-    pipe_channel = ( int ** ) calloc( ncmds, sizeof( int * ) );
-    if ( NULL == pipe_channel ) {
+    // Linear probing ( the table is never full )
+    for ( i = fp & ( inc->nslots - 1 ); 0 != *( inc->slots + i ) && fp != *( inc->slots + i );
+          i = ( i + 1 ) & ( inc->nslots - 1 ) );
 
-        // Echo error
-        fprintf( stdout, "\t@sh_exec_minor_command_set(): calloc for $pipe_channel failed: %s\n", strerror( errno ) );
+    return inc->slots + i;
 
-        // Return failure
-        return false;
+}
+/*
+ * Fold the inputs of an 'inputs:' directive into the next row's inputs fingerprint
+ */
+static void sh_inc_inputs ( sh_inc_t *inc, const char *val, size_t vlen ) {
 
-    }
+    // Vars
+    char path[DIR_LEN_MAX];
+    struct stat st;
+    size_t i, j;
 
-    // Init pipe channels
-    for ( i = 0; i < ncmds; ++i ) {
+    for ( i = 0; i < vlen; i = j ) {
 
-        // Allocate pipe channel
-        *( pipe_channel + i ) = ( int * ) calloc( 2, sizeof( int ) );
-        if ( NULL == *( pipe_channel + i ) ) {
+        // Next path
+        for ( ; i < vlen && ( isspace( ( unsigned char ) *( val + i ) ) || ',' == *( val + i ) ); ++i );
+        for ( j = i; j < vlen && !isspace( ( unsigned char ) *( val + j ) ) && ',' != *( val + j ); ++j );
+        if ( i == j ) break;
 
-            // Echo error
-            fprintf( stdout, "\t@sh_exec_minor_command_set(): calloc for $pipe_channel[%zu] failed: %s\n", i,
-                     strerror( errno ) );
+        // Stat it ( relative to the current working directory, which is part of the fingerprint )
+        if ( j - i >= DIR_LEN_MAX ) {
+            inc->missing = true;
+            continue;
+        }
+        memcpy( path, val + i, j - i );
+        *( path + j - i ) = '\0';
+        if ( stat( path, &st ) < 0 ) {
 
-            // Dealloc used memory for pipes
-            free( pipe_channel );
+            // DEBUGGING:
+            if ( SH_DBG( 1 ) )
+                fprintf( stdout, "\t@sh_inc_inputs(): %s: %s\n", path, strerror( errno ) );
 
-            // Return failure
-            return false;
+            inc->missing = true;
+            continue;
 
         }
 
-        // Create the pipe for each channel
-        // If pipe() < 0, means that descriptors could not be initialized
-        if ( pipe( *( pipe_channel + i ) ) < 0 ) {
+        inc->inputs = sh_inc_mix( inc->inputs, sh_plan_hash( path, j - i ) );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_dev );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_ino );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_size );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_mtim.tv_sec );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_mtim.tv_nsec );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_ctim.tv_sec );
+        inc->inputs = sh_inc_mix( inc->inputs, ( size_t ) st.st_ctim.tv_nsec );
 
-            // Print error in stdout
-            fprintf( stdout, "\t@sh_exec_minor_command_set(): pipe() error: %s\n", strerror( errno ) );
+    }
 
-            // Dealloc used memory for pipes
-            free( pipe_channel );
+}
+/*
+ * Load the journal of a batch file's last run
+ *
+ * @param inc [sh_inc_t]: To be passed to sh_inc_skip(), sh_inc_done() and sh_inc_close()
+ * @param bfname [string]: The batch file's name
+ * @return [bool]: TRUE if the journal was loaded ( or does not exist yet ), FALSE on failure ( reported )
+ */
+bool sh_inc_open ( sh_inc_t *inc, const char *bfname ) {
 
-            // Return false to inform for failure
-            return false;
+    // Vars
+    char *real, line[32];
+    FILE *fp;
+    size_t fprint, *slot;
 
-        }
+    // Init
+    memset( inc, 0, sizeof( sh_inc_t ) );
 
-    }
+    // Journal's path ( absolute, rows may change the working directory )
+    real = realpath( bfname, NULL );
+    inc->path = NULL == real ? NULL : ( char * ) malloc( strlen( real ) + sizeof( INC_JOURNAL_EXT ) );
+    if ( NULL == inc->path ) {
 
+        // Report error
+        fprintf( stdout, "\t@sh_inc_open(): %s: journal's path could not be created: %s\n", bfname,
+                 strerror( errno ) );
 
-    /*
-     * ----------------------------
-     * Execution of MINOR commands
-     * ----------------------------
-     *
-     * To execute the commands in the minor command-set, we use two main processes.
-     *  - parent process:   executes the minor commands assigning the execution to a forked process per command
-     *  - child process :   listens to the READ_EDGE of the last pipe to read the final output,
-     *                      then it prints to stdout and exits
-     *
-     * Failure:
-     * In the case that a command fails ( return status non-zero ) the execution stops and parent returns FALSE.
-     *
-     */
+        // Return failure
+        free( real );
+        return false;
 
-    // Fork process
-    pid = fork();
-    if ( pid < 0 ) {
+    }
+    strcpy( inc->path, real );
+    strcat( inc->path, INC_JOURNAL_EXT );
+    free( real );
+
+    // Read fingerprints ( one per line, in hex )
+    fp = fopen( inc->path, "r" );
+    if ( NULL == fp ) {
 
-        // Print error in stdout
-        fprintf( stdout, "\t@sh_exec_minor_command_set(): fork failed: %s\n", strerror( errno ) );
+        if ( ENOENT == errno ) return true;
 
-        // Dealloc used memory for pipes
-        free( pipe_channel );
+        // Report error
+        fprintf( stdout, "\t@sh_inc_open(): %s: %s\n", inc->path, strerror( errno ) );
 
-        // Return false to inform for failure
+        // Return failure
+        free( inc->path );
         return false;
 
     }
+    while ( NULL != fgets( line, sizeof( line ), fp ) ) {
 
-    /* Child Process */
-    if ( pid == 0 ) {
-
-        // Execute sh_exec_response
-        sh_exec_response( ncmds, pipe_channel );
+        fprint = ( size_t ) strtoull( line, NULL, 16 );
+        if ( 0 != fprint && !sh_batch_grow( ( void ** ) &inc->done, &inc->cap, inc->ndone + 1, sizeof( size_t ) ) )
+            break;
+        if ( 0 != fprint ) *( inc->done + inc->ndone++ ) = fprint;
 
-        // Child collected response
-        _exit( EXIT_SUCCESS );
+    }
+    fclose( fp );
 
-        /* Parent Process */
-    } else {
+    // Index them ( load factor at most 1/2 )
+    for ( inc->nslots = 64; inc->nslots < 2 * inc->ndone; inc->nslots *= 2 );
+    inc->slots = ( size_t * ) calloc( inc->nslots, sizeof( size_t ) );
+    if ( NULL == inc->slots ) {
 
-        // Execute MINOR command-set and get result
-        result = sh_exec_wrapper( row->cmds + idx, ncmds, pipe_channel );
+        // Report error
+        fprintf( stdout, "\t@sh_inc_open(): calloc for $slots failed: %s\n", strerror( errno ) );
 
-        // Inspect execution result
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_exec_minor_command_set(): sh_exec_wrapper() exited with status: %d\n",
-                     result ? EXIT_SUCCESS : EXIT_FAILURE );
+        // Return failure
+        free( inc->path );
+        free( inc->done );
+        return false;
 
-        // Wait for response collector ( do not care about return status )
-        waitpid( pid, NULL, 0 );
+    }
+    for ( ; inc->ndone > 0; inc->ndone-- ) {
+        slot = sh_inc_slot( inc, *( inc->done + inc->ndone - 1 ) );
+        *slot = *( inc->done + inc->ndone - 1 );
+    }
 
-        // UPDATE: If execution fails, try searching if command was a batch file's name
-        if ( !result && sh_get_env( SH_ON_CMD_FAIL_SEARCH_BF_KEY, SH_ON_CMD_FAIL_SEARCH_BF_DEFAULT ) ) {
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_inc_open(): %s: loaded\n", inc->path );
 
-            // Report for redirection
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-                fprintf( stdout, "\t@sh_exec_wrapper(): command failed - searching for batch file '%s'\n",
-                         ( row->cmds + idx )->cmd );
+    return true;
 
-            // Check as filename
-            char *fname;
+}
+/*
+ * Check if a batch file's row may be skipped
+ *
+ * Empty rows, comments and directives have nothing to execute. Other rows are skipped if their fingerprint was
+ * journaled by the last run ( they are journaled again, as succeeded ).
+ *
+ * @param row [string]: The row ( not NULL-terminated )
+ * @param len [size_t]: Length of $row
+ * @param fp [size_t]: Set to the row's fingerprint, to be passed to sh_inc_done() if it succeeds ( 0 if it must not )
+ * @return [bool]: TRUE if $row should not be executed, FALSE otherwise
+ */
+bool sh_inc_skip ( sh_inc_t *inc, const char *row, size_t len, size_t *fp ) {
 
-            // Search
-            fname = sh_file_exists( ( row->cmds + idx )->cmd );
+    // Vars
+    sh_row_t prow;
+    sh_mark_t mark;
+    const char *val;
+    size_t vlen;
+    bool loaded;
 
-            // Check returned string
-            // If is not NULL, then a command is an existent file
-            // Execute file in batch mode and return this result
-            if ( NULL != fname ) {  // Found as filename
+    // Init
+    *fp = 0;
 
-                // Execute
-                result = mode_b( fname );
+    // Inputs of the next row
+    if ( sh_batch_directive( row, len, "inputs:", &val, &vlen ) ) {
+        sh_inc_inputs( inc, val, vlen );
+        return true;
+    }
 
-                // Free resources
-                free( fname );
+    // Parse row ( cached for its execution )
+    mark = sh_arena_mark( &SH_ARENA );
+    loaded = sh_row_load( row, len, &prow, true );
+    if ( loaded && 0 == prow.ncmds ) {
+        sh_arena_release( &SH_ARENA, mark );
+        return true;
+    }
 
-            }
+    // Fingerprint row ( not if it changes the shell's state or an input is missing )
+    if ( loaded && !sh_row_stateful( &prow ) && !inc->missing ) {
 
-        }
+        *fp = sh_inc_mix( sh_plan_hash( prow.raw, strlen( prow.raw ) ), sh_plan_hash( SH_WD, strlen( SH_WD ) ) );
+        *fp = sh_inc_mix( *fp, inc->inputs );
+        if ( 0 == *fp ) *fp = 1;
 
     }
+    sh_arena_release( &SH_ARENA, mark );
 
-    // Dealloc used memory for pipes
-    for ( i = 0; i < ncmds; ++i ) free( *( pipe_channel + i ) );
-    free( pipe_channel );
+    // Declared inputs are the row's only
+    inc->inputs = 0;
+    inc->missing = false;
 
-    // Inform MAJOR about execution result
-    return result;
+    // Check last run
+    if ( 0 == *fp || NULL == inc->slots || *sh_inc_slot( inc, *fp ) != *fp ) return false;
+
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_inc_skip(): unchanged since last run, skipping: '%.*s'\n", ( int ) len, row );
+
+    sh_inc_done( inc, *fp );
+    inc->nskip++;
+    return true;
 
 }
 /*
- * Execution of a minor command-set
- * In MINOR command-set only pipes are allowed between commands
+ * Journal a succeeded row
+ *
+ * @param fp [size_t]: The row's fingerprint ( see sh_inc_skip(), nothing is journaled if 0 )
  */
-bool sh_exec_wrapper ( sh_cmd_t *cmds, size_t ncmds, int **pd ) {
+void sh_inc_done ( sh_inc_t *inc, size_t fp ) {
 
-    // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 ) {
-        fprintf( stdout, "\t@sh_exec_wrapper(): pipe_channel inspection start\n" );
-        sh_inspect_pipes( pd, ncmds );
-        fprintf( stdout, "\t@sh_exec_wrapper(): pipe_channel inspection stop\n" );
-    }
+    if ( 0 != fp && sh_batch_grow( ( void ** ) &inc->done, &inc->cap, inc->ndone + 1, sizeof( size_t ) ) )
+        *( inc->done + inc->ndone++ ) = fp;
+
+}
+/*
+ * Write the journal for the next run and free resources
+ *
+ * The journal is replaced atomically ( written aside, synced and renamed ), so a crash leaves the last one intact.
+ *
+ * @param complete [bool]: All rows were read; if FALSE, the last run's fingerprints are kept too ( rows not reached
+ *                         may still be skipped next time )
+ * @return [bool]: TRUE if the journal was written, FALSE otherwise ( reported )
+ */
+bool sh_inc_close ( sh_inc_t *inc, bool complete ) {
 
     // Vars
-    bool result;
-    pid_t *pid;
+    char *tmp;
+    FILE *fp;
     size_t i;
+    bool ok;
 
-    // Init
-    // We will fork so many processes as are the commands of current MINOR
-    pid = ( pid_t * ) calloc( ncmds, sizeof( pid_t ) );
-    if ( NULL == pid ) {
-
-        // Echo error
-        fprintf( stdout, "\t@sh_exec_wrapper(): calloc for $pid failed: %s\n", strerror( errno ) );
-
-        // Return failure
-        return false;
+    // DEBUGGING:
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_inc_close(): %zu rows skipped, %zu journaled\n", inc->nskip, inc->ndone );
+
+    // Write to "<journal>.tmp"
+    tmp = ( char * ) malloc( strlen( inc->path ) + sizeof( ".tmp" ) );
+    fp = NULL;
+    if ( NULL != tmp ) {
+        strcpy( tmp, inc->path );
+        strcat( tmp, ".tmp" );
+        fp = fopen( tmp, "w" );
+    }
+    ok = NULL != fp;
+    for ( i = 0; ok && i < inc->ndone; ++i ) ok = fprintf( fp, "%016zx\n", *( inc->done + i ) ) > 0;
+    for ( i = 0; ok && !complete && i < inc->nslots; ++i )
+        if ( 0 != *( inc->slots + i ) ) ok = fprintf( fp, "%016zx\n", *( inc->slots + i ) ) > 0;
 
+    // Sync, then replace journal
+    if ( NULL != fp ) {
+        ok = ok && 0 == fflush( fp ) && 0 == fsync( fileno( fp ) );
+        ok = 0 == fclose( fp ) && ok;
     }
+    ok = ok && 0 == rename( tmp, inc->path );
+    if ( !ok ) {
 
-    result = true;      // overall result ( if any child fails, this becomes FALSE )
+        // Report error
+        fprintf( stdout, "\t@sh_inc_close(): %s: journal could not be written: %s\n", inc->path, strerror( errno ) );
 
-    // Execute commands, forking each to a child process
-    for ( i = 0; i < ncmds; ++i ) {
+        if ( NULL != tmp ) unlink( tmp );
 
-        // File nos
-        int fileno_stdin, fileno_stdout;
+    }
 
-        // Create a process for first command
-        *( pid + i ) = fork();
-        if ( *( pid + i ) < 0 ) {
+    // Free resources
+    free( tmp );
+    free( inc->path );
+    free( inc->slots );
+    free( inc->done );
 
-            // Print error in stdout
-            fprintf( stdout, "\t@sh_exec_wrapper(): fork() error ( i = %zu ): %s\n", i, strerror( errno ) );
+    return ok;
 
-            // Break out of loop
-            break;
+}
+/*
+ * -------------------
+ * Look-ahead parsing
+ * -------------------
+ *
+ * In sequential batch mode a parser thread reads and parses the rows of the ( mapped ) batch file ahead of the
+ * main thread, which only executes them: parse time overlaps execution instead of adding to it.
+ *
+ * Parsed rows are handed over in a bounded single-producer / single-consumer ring of $SH_PARSE_AHEAD items, with
+ * no locks: the parser thread only writes $tail and the main thread only writes $head. A side that finds the ring
+ * empty ( or full ) sleeps on the other side's index with a futex, after raising its wait flag, so the other side
+ * only makes a system call when someone actually waits.
+ *
+ * Parsing depends only on the row's text ( see Plan cache ), so rows may be parsed before the previous ones have
+ * run. The parser thread parses in its own $SH_ARENA ( it is thread-local ) and without the plan cache, then
+ * copies each row to a self-contained image that the main thread executes in place and frees. Signals are blocked
+ * in the parser thread, so they are handled by the main thread as before.
+ *
+ */
+/*
+ * Futex wait / wake ( private to the process )
+ */
+static void sh_futex_wait ( uint32_t *addr, uint32_t val ) {
+    syscall( SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0 );
+}
+static void sh_futex_wake ( uint32_t *addr ) {
+    syscall( SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+}
+/*
+ * Parse a row to a queue's item
+ */
+static void sh_ahead_parse ( sh_ahead_t *item ) {
 
+    // Vars
+    sh_row_t row;
+    sh_mark_t mark;
+
+    item->parsed = false;
+    item->blk = NULL;
+    if ( NULL == item->raw || sh_quit( item->raw, item->len ) ) return;
+
+    mark = sh_arena_mark( &SH_ARENA );
+    if ( sh_row_load( item->raw, item->len, &row, false ) ) {
+
+        // Empty rows and comments have nothing to copy
+        if ( 0 == row.ncmds ) {
+            item->row = row;
+            item->parsed = true;
+        } else if ( NULL != ( item->blk = ( char * ) malloc( sh_plan_size( &row ) ) ) ) {
+            sh_plan_copy( &item->row, &row, item->blk );
+            item->parsed = true;
         }
 
-        /*
-         * New command in a new process (the child process)
-         *
-         *  input: pd[i-1][1] (instead of STDOUT_FILENO)
-         *  output: pd[i][0] (instead of STDOUT_FILENO)
-         */
-        if ( *( pid + i ) == 0 ) {
-
-            /*
-             * -----------
-             * Setup pipe
-             * -----------
-             *
-             * The pipe channel has been created and accessed @ $pipe_channel[ $pos ][ $READ_EDGE / $WRITE_EDGE ].
-             * Before executing the command, we should setup the READ / WRITE edge of its pipe channel.
-             *
-             */
-            if ( NULL != pd ) {
+    }
+    sh_arena_release( &SH_ARENA, mark );
 
-                if ( NULL != pd ) {
+}
+/*
+ * Parser thread
+ */
+static void *sh_ahead_main ( void *arg ) {
 
-                    // Check if command has specified input or output file(s)
-                    // For input file the arg '<' should exist in $cmd->args and a valid filename should have been given
-                    // For output file the arg '>' should exist in $cmd->args and a valid filename should have been given
-                    size_t lt_index, gt_index;
+    // Vars
+    sh_aqueue_t *q;
+    sh_ahead_t *item;
+    uint32_t tail;
+
+    q = ( sh_aqueue_t * ) arg;
+    item = NULL;
+    tail = 0;
+    SH_DBG_MUTE = true;
+    do {
 
-                    // Input check
-                    lt_index = sh_cmd_lt_arg_exists( cmds + i );
-                    if ( lt_index > 0 && ( cmds + i )->nargs > lt_index + 1 ) {
+        // Wait for a free item
+        while ( tail - __atomic_load_n( &q->head, __ATOMIC_ACQUIRE ) == q->cap ) {
 
-                        // Get input file's name
-                        char *fname_in;
-                        fname_in = strdup( *( ( cmds + i )->args + lt_index + 1 ) );
+            __atomic_store_n( &q->pwait, 1, __ATOMIC_SEQ_CST );
+            if ( __atomic_load_n( &q->stop, __ATOMIC_ACQUIRE ) ) break;
+            if ( tail - __atomic_load_n( &q->head, __ATOMIC_SEQ_CST ) == q->cap )
+                sh_futex_wait( &q->head, tail - q->cap );
 
-                        // DEBUGGING:
-                        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-                            fprintf( stdout, "\t@sh_exec_wrapper(): '%s': input file set\n", fname_in );
+        }
 
-                        // Check if file exists
-                        FILE *fpin = fopen( fname_in, "r" );
-                        if ( NULL != fpin ) {
+        // Only the waiting side clears its flag ( a clear by the waker could wipe a newer wait's flag )
+        __atomic_store_n( &q->pwait, 0, __ATOMIC_SEQ_CST );
+        if ( __atomic_load_n( &q->stop, __ATOMIC_ACQUIRE ) ) break;
 
-                            // Assign file no of open file stream
-                            fileno_stdin = fileno( fpin );
+        // Read and parse next row ( the end of input, or an exit, is handed over too )
+        item = q->items + ( tail & ( q->cap - 1 ) );
+        item->raw = sh_reader_next( q->rd, &item->len );
+        sh_ahead_parse( item );
 
-                            // Remove arguments relevant to this operation
-                            sh_cmd_purge_args( cmds + i, lt_index, 2 );
+        // Publish it
+        __atomic_store_n( &q->tail, ++tail, __ATOMIC_SEQ_CST );
+        if ( __atomic_load_n( &q->cwait, __ATOMIC_SEQ_CST ) ) sh_futex_wake( &q->tail );
 
-                            // DEBUGGING:
-                            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-                                ( cmds + i )->utils->inspect( cmds + i );
+    } while ( NULL != item->raw && !sh_quit( item->raw, item->len ) );
 
-                        } else {
+    // Free resources ( thread's arena )
+    sh_arena_free( &SH_ARENA );
 
-                            // Fallback to default pipe's file no
-                            fileno_stdin = 0 < i ? pd[ i - 1 ][ READ_EDGE ] : STDIN_FILENO;
+    return NULL;
 
-                        }
+}
+/*
+ * Start parsing a batch file's rows ahead of their execution
+ *
+ * @param q [sh_aqueue_t]: The queue ( to be passed to sh_ahead_next() and sh_ahead_stop() )
+ * @param rd [sh_reader_t]: The batch file's reader ( mapped; not to be used until sh_ahead_stop() )
+ * @param depth [size_t]: Number of rows parsed ahead ( rounded up to a power of 2 )
+ * @return [bool]: TRUE if the parser thread was started, FALSE otherwise ( rows should be parsed as they run )
+ */
+bool sh_ahead_start ( sh_aqueue_t *q, sh_reader_t *rd, size_t depth ) {
 
-                    } else fileno_stdin = 0 < i ? pd[ i - 1 ][ READ_EDGE ] : STDIN_FILENO;
+    // Vars
+    sigset_t all, old;
+    int err;
 
-                    // Output check
-                    gt_index = sh_cmd_gt_arg_exists( cmds + i );
-                    if ( gt_index > 0 && ( cmds + i )->nargs > gt_index + 1 ) {
+    // Init
+    memset( q, 0, sizeof( sh_aqueue_t ) );
+    q->rd = rd;
+    for ( q->cap = 1; q->cap < depth && q->cap < ( 1u << 20 ); q->cap <<= 1 );
+    q->items = ( sh_ahead_t * ) calloc( q->cap, sizeof( sh_ahead_t ) );
+    if ( NULL == q->items ) {
 
-                        // Get input file's name
-                        char *fname_out;
-                        fname_out = strdup( *( ( cmds + i )->args + gt_index + 1 ) );
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_ahead_start(): calloc for $items failed: %s\n", strerror( errno ) );
 
-                        // DEBUGGING:
-                        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-                            fprintf( stdout, "\t@sh_exec_wrapper(): '%s': output file set\n", fname_out );
+        return false;
 
-                        // Check if file exists
-                        FILE *fpout = fopen( fname_out, "a+" );
-                        if ( NULL == fpout ) {
+    }
 
-                            // Fallback to default pipe's file no
-                            fileno_stdout = pd[ i ][ WRITE_EDGE ];
+    // Start parser thread ( with all signals blocked )
+    sigfillset( &all );
+    pthread_sigmask( SIG_SETMASK, &all, &old );
+    err = pthread_create( &q->tid, NULL, sh_ahead_main, q );
+    pthread_sigmask( SIG_SETMASK, &old, NULL );
+    if ( 0 != err ) {
 
-                        } else {
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_ahead_start(): pthread_create failed: %s\n", strerror( err ) );
 
-                            // Assign open file no to fpout
-                            fileno_stdout = fileno( fpout );
+        free( q->items );
+        return false;
 
-                            // Remove arguments relevant to this operation
-                            if ( !sh_cmd_purge_args(cmds + i, gt_index, 2 ) ) {
+    }
 
-                                // DEBUGGING:
-                                if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-                                    fprintf( stdout, "\t@sh_exec_wrapper(): sh_cmd_purge_args() failed\n" );
+    return true;
 
-                                // Fallback to default pipe's file no
-                                fileno_stdout = pd[ i ][ WRITE_EDGE ];
+}
+/*
+ * Get next parsed row ( waits for the parser thread )
+ *
+ * @return [sh_ahead_t]: The row, to be passed to sh_ahead_exec() ( $raw is NULL at the end of input )
+ */
+sh_ahead_t *sh_ahead_next ( sh_aqueue_t *q ) {
 
-                            }
+    // Vars
+    uint32_t head;
 
-                            // DEBUGGING:
-                            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 )
-                                ( cmds + i )->utils->inspect( cmds + i );
+    // Wait for an item
+    head = q->head;
+    while ( __atomic_load_n( &q->tail, __ATOMIC_ACQUIRE ) == head ) {
 
-                        }
+        __atomic_store_n( &q->cwait, 1, __ATOMIC_SEQ_CST );
+        if ( __atomic_load_n( &q->tail, __ATOMIC_SEQ_CST ) == head ) sh_futex_wait( &q->tail, head );
 
-                    } else fileno_stdout = pd[ i ][ WRITE_EDGE ];
+    }
+    __atomic_store_n( &q->cwait, 0, __ATOMIC_SEQ_CST );
 
-                    // Duplicate descriptors
-                    dup2( fileno_stdin, STDIN_FILENO );
-                    dup2( fileno_stdout, STDOUT_FILENO );
+    return q->items + ( head & ( q->cap - 1 ) );
 
-                    // Child: Close all descriptors
-                    for ( size_t ci = 0; ci < ncmds; ++ci ) {
-                        close( pd[ ci ][ READ_EDGE ] );
-                        close( pd[ ci ][ WRITE_EDGE ] );
-                    }
+}
+/*
+ * Execute a row got from sh_ahead_next()
+ *
+ * @return [bool]: The row's execution result
+ */
+bool sh_ahead_exec ( sh_ahead_t *item ) {
 
-                    // Check for file descriptors
-                    if ( ( 0 < i && fileno_stdin != pd[ i - 1 ][ READ_EDGE ] ) || fileno_stdin != STDIN_FILENO ) close( fileno_stdin );
-                    if ( fileno_stdout != pd[ i ][ WRITE_EDGE ] ) close( fileno_stdout );
+    // Vars
+    sh_mark_t mark;
+    bool result;
 
-                }
+    // Rows the parser thread could not parse are parsed now ( reporting the failure )
+    if ( !item->parsed ) result = sh_parse_exec_row( item->raw, item->len );
+    else if ( 0 == item->row.ncmds ) result = true;
+    else {
 
-            }
+        // Inspect
+        if ( SH_DBG( 2 ) )
+            item->row.utils->inspect( &item->row );
 
-            // Execute command and get execution result
-            result = sh_exec( cmds + i );
+        // Execute in place ( execution's own memory is taken from $SH_ARENA )
+        mark = sh_arena_mark( &SH_ARENA );
+        result = item->row.utils->exec( &item->row );
+        sh_arena_release( &SH_ARENA, mark );
 
-            // Check if command is valid
-            if ( !result ) {
+    }
 
-                // If command is returned <> 0, inform to stdout
-                fprintf( stdout, "\t@sh_exec_wrapper(): %s: command failed: %s\n",
-                         ( cmds + i )->cmd, strerror( errno ) );
+    return result;
 
-                // Close std file streams ( as would a successful execution )
-                fclose( stdin );
-                fclose( stdout );
+}
+/*
+ * Release the item got last from sh_ahead_next()
+ */
+void sh_ahead_pop ( sh_aqueue_t *q ) {
 
-                // If reached here..
-                _exit( EXIT_FAILURE );
+    free( ( q->items + ( q->head & ( q->cap - 1 ) ) )->blk );
+    __atomic_store_n( &q->head, q->head + 1, __ATOMIC_SEQ_CST );
+    if ( __atomic_load_n( &q->pwait, __ATOMIC_SEQ_CST ) ) sh_futex_wake( &q->head );
 
-            }
+}
+/*
+ * Stop the parser thread and free the rows it parsed ahead
+ */
+void sh_ahead_stop ( sh_aqueue_t *q ) {
 
-            // Command executed successfully
-            _exit( EXIT_SUCCESS );
+    // Vars
+    uint32_t head, i;
 
-        }
+    // Stop it, waking it up if the ring is full ( the ring looks empty to it from now on )
+    head = q->head;
+    __atomic_store_n( &q->stop, true, __ATOMIC_SEQ_CST );
+    __atomic_store_n( &q->head, head + q->cap, __ATOMIC_SEQ_CST );
+    sh_futex_wake( &q->head );
+    pthread_join( q->tid, NULL );
 
-    }
+    // Free resources
+    for ( i = head; i != q->tail; ++i ) free( ( q->items + ( i & ( q->cap - 1 ) ) )->blk );
+    free( q->items );
 
-    // Parent: Close all descriptors
-    if ( NULL != pd ) {
+}
+/*
+ * -------------------
+ * Batch checkpoints
+ * -------------------
+ *
+ * While the shell runs a batch file, the index of each finished row and its result are appended to a journal next
+ * to the batch file ( CKPT_JOURNAL_EXT ). Records are grouped: they are written and synced every CKPT_SYNC_ROWS rows
+ * or CKPT_SYNC_MS milliseconds, so rows that take milliseconds pay one fdatasync() per group, and a crash loses at
+ * most the last group ( whose rows run again ). The journal itself is only created by the first group, the first
+ * failed row or an interruption: short runs that succeed never touch the disk. It is removed when all rows of the
+ * file succeeded. A run holds an exclusive flock() on its journal, concurrent runs of the same file do not journal.
+ *
+ * With --resume, rows the journal records as succeeded are skipped, so a run that died ( SIGINT, OOM, reboot, ... )
+ * continues from its first unfinished row; failed rows run again. Rows that change the shell's state ( e.g. cd, set )
+ * always run, as later rows depend on them. The journal's header holds the batch file's size and modification time:
+ * a file edited since then cannot be resumed.
+ *
+ *      journal:    "chsh-ckpt <size> <mtime sec> <mtime nsec>\n" { "<row index> <o|f>\n" }
+ *
+ */
+/*
+ * Open the journal and lock it ( the lock is dropped when the journal is closed )
+ *
+ * @param flags [int]: open() flags ( O_CREAT to create it )
+ * @return [int]: The journal's descriptor, -1 if it cannot be opened or another run holds it ( errno is EWOULDBLOCK )
+ */
+static int sh_ckpt_lock ( const sh_ckpt_t *ck, int flags ) {
 
-        for ( i = 0; i < ncmds; ++i ) {
+    // Vars
+    struct stat fst, pst;
+    int fd, i;
 
-            close( pd[ i ][ READ_EDGE ] );
-            close( pd[ i ][ WRITE_EDGE ] );
+    for ( i = 0; i < 3; ++i ) {
 
+        fd = open( ck->path, O_WRONLY | O_APPEND | O_CLOEXEC | flags, 0644 );
+        if ( fd < 0 ) return -1;
+        if ( flock( fd, LOCK_EX | LOCK_NB ) < 0 ) {
+            close( fd );
+            return -1;
         }
 
+        // A run that just finished may have removed it before it was locked: open the new one
+        if ( fstat( fd, &fst ) == 0 && stat( ck->path, &pst ) == 0 && fst.st_dev == pst.st_dev &&
+             fst.st_ino == pst.st_ino )
+            return fd;
+        close( fd );
+        if ( 0 == ( flags & O_CREAT ) ) break;
+
     }
 
-    // Parent: Wait for all known pids to die
-    for ( i = 0; i < ncmds; ++i ) {
+    errno = ENOENT;
+    return -1;
 
-        // Get return status of dead child
-        int status;
-        waitpid( *( pid + i ), &status, 0 );
+}
+/*
+ * Write pending records and sync them ( creating the journal first, if not created yet )
+ */
+static void sh_ckpt_sync ( sh_ckpt_t *ck ) {
 
-        // Check $status
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_exec_wrapper(): -- child [pid = %d] finished with status: %d\n", *( pid + i ),
-                     status );
+    // Vars
+    size_t off;
+    ssize_t n;
 
-        // Return
-        if ( EXIT_SUCCESS != status ) {
+    // Create journal ( emptied only once locked, it may hold an older run's records )
+    if ( ck->pending ) {
 
-            // DEBUGGING:
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-                fprintf( stdout, "\t@sh_exec_wrapper(): -- status states failure, aborting\n" );
+        ck->pending = false;
+        ck->fd = sh_ckpt_lock( ck, O_CREAT );
+        if ( ck->fd < 0 || ftruncate( ck->fd, 0 ) < 0 ) {
 
-            // Assign overall result to FALSE
-            result = false;
+            // DEBUGGING:
+            if ( SH_DBG( 1 ) )
+                fprintf( stdout, "\t@sh_ckpt_sync(): %s: not journaling: %s\n", ck->path, strerror( errno ) );
 
-            // Exit wait loop
-            break;
+            if ( ck->fd >= 0 ) close( ck->fd );
+            ck->fd = -1;
+            return;
 
         }
 
     }
+    if ( ck->fd < 0 ) return;
 
-    return result;
+    for ( off = 0; off < ck->len; off += ( size_t ) n ) {
 
-}
-void sh_exec_response ( size_t ncmds, int **pd ) {
+        n = write( ck->fd, ck->buf + off, ck->len - off );
+        if ( n < 0 && EINTR == errno ) n = 0;
+        else if ( n < 0 ) {
 
-    int i;
-    char buf[BUF_LEN_MAX];
+            // Report error
+            fprintf( stdout, "\t@sh_ckpt_sync(): %s: journaling stopped: %s\n", ck->path, strerror( errno ) );
+
+            close( ck->fd );
+            ck->fd = -1;
+            return;
+
+        }
 
-    // Close all descriptors
-    close( pd[ ncmds - 1 ][ WRITE_EDGE ] );
-    for ( i = 0; i < ncmds - 1; ++i ) {
-        close( pd[ i ][ READ_EDGE ] );
-        close( pd[ i ][ WRITE_EDGE ] );
     }
+    fdatasync( ck->fd );
 
-    i = 0;
-    while ( read( pd[ ncmds - 1 ][ READ_EDGE ], buf + i++, 1 ) > 0 );
+    ck->len = ck->nrec = 0;
+    clock_gettime( CLOCK_MONOTONIC, &ck->synced );
+
+}
+/*
+ * Read the journal of an interrupted run ( --resume )
+ *
+ * @param st [struct stat]: The batch file's stat
+ * @return [bool]: TRUE if the journal was read ( or does not exist ), FALSE if it does not match the batch file
+ */
+static bool sh_ckpt_load ( sh_ckpt_t *ck, const struct stat *st ) {
 
-    // Terminate string
-    if ( i > 2 ) {
+    // Vars
+    char line[64], res;
+    FILE *fp;
+    long long size, sec, nsec;
+    size_t idx, nbytes;
+    bool ok;
 
-        *( buf + ( i - 2 ) ) = '\n';    // if not last character was new line
-        *( buf + ( i - 1 ) ) = '\0';    // for normal termination
+    fp = fopen( ck->path, "r" );
+    if ( NULL == fp ) {
 
-    } else {
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_ckpt_load(): %s: %s, starting from first row\n", ck->path, strerror( errno ) );
 
-        // No output
-        *buf = '\0';
+        return ENOENT == errno;
 
     }
 
-    // Close pipe
-    close( pd[ ncmds - 1 ][ READ_EDGE ] );
+    // Check header
+    ok = NULL != fgets( line, sizeof( line ), fp ) &&
+         3 == sscanf( line, "chsh-ckpt %lld %lld %lld", &size, &sec, &nsec ) && size == ( long long ) st->st_size &&
+         sec == ( long long ) st->st_mtim.tv_sec && nsec == ( long long ) st->st_mtim.tv_nsec;
+    if ( !ok ) fprintf( stdout, "\t@mode_b(): --resume: batch file changed since %s was written\n", ck->path );
+
+    // Read records ( later ones win )
+    nbytes = 0;
+    while ( ok && NULL != fgets( line, sizeof( line ), fp ) ) {
+
+        if ( 2 != sscanf( line, "%zu %c", &idx, &res ) ) continue;
+        if ( idx / 8 >= nbytes ) {
+            ok = sh_batch_grow( ( void ** ) &ck->ok, &nbytes, idx / 8 + 1, 1 );
+            if ( !ok ) break;
+            memset( ck->ok + ck->nok / 8, 0, nbytes - ck->nok / 8 );
+            ck->nok = 8 * nbytes;
+        }
+        if ( 'o' == res ) *( ck->ok + idx / 8 ) |= ( unsigned char ) ( 1u << idx % 8 );
+        else *( ck->ok + idx / 8 ) &= ( unsigned char ) ~( 1u << idx % 8 );
 
-    // Print what's read
-    fwrite( buf, 1, strlen( buf ), stdout );
+    }
+    fclose( fp );
 
-    // Close stdout
-    fclose( stdout );
+    return ok;
 
 }
 /*
- * Executes a single command
+ * Start journaling a batch file's run ( and, with --resume, read the interrupted run's journal )
  *
- * It forks a children which transfers execution via execvp().
- * The parent waits for the return status of its child, and if 0 returns true else returns false.
- * Does not takes care of pipes ( it is assumed that the wrapper set the pipe channel etc. )
+ * The journal is not created here ( see sh_ckpt_sync() ). The run is not journaled if the journal cannot be created
+ * ( e.g. read-only directory ) or another run of the file holds it.
+ *
+ * @param ck [sh_ckpt_t]: To be passed to sh_ckpt_skip(), sh_ckpt_done() and sh_ckpt_close()
+ * @param bfname [string]: The batch file's name
+ * @param fd [int]: The batch file's descriptor
+ * @return [bool]: TRUE on success, FALSE if the interrupted run cannot be resumed ( reported )
  */
-bool sh_exec ( sh_cmd_t *cmd ) {
-
-    // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, "\t@sh_exec(): executing --%s--\n", NULL != cmd->cmd ? cmd->cmd : "(null)\n" );
+bool sh_ckpt_open ( sh_ckpt_t *ck, const char *bfname, int fd ) {
 
-    // First sh_cmd_parse command ( if not parsed before )
-    cmd->utils->parse( cmd );
-
-    // Inspect command
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 2 ) cmd->utils->inspect( cmd );
-
-    // Check if command is valid
-    if ( !cmd->utils->isvalid( cmd ) ) return false;
+    // Vars
+    struct stat st;
+    char *real;
+    int len;
 
-    // Check if is built-in command
-    if ( cmd->is_blt ) return sh_exec_builtin( cmd );
+    // Init
+    memset( ck, 0, sizeof( sh_ckpt_t ) );
+    ck->fd = -1;
+    clock_gettime( CLOCK_MONOTONIC, &ck->synced );
 
-    // Vars
-    pid_t pid = fork();
+    // Journal's path ( absolute, rows may change the working directory )
+    real = realpath( bfname, NULL );
+    ck->path = NULL == real ? NULL : ( char * ) malloc( strlen( real ) + sizeof( CKPT_JOURNAL_EXT ) );
+    if ( NULL == ck->path || fstat( fd, &st ) < 0 ) {
 
-    // Check fork
-    if ( pid < 0 ) {
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_ckpt_open(): %s: not journaling: %s\n", bfname, strerror( errno ) );
 
-        // Print error in stdout
-        fprintf( stdout, "\t@sh_exec(): fork failed: %s\n", strerror( errno ) );
+        free( real );
+        free( ck->path );
+        ck->path = NULL;
+        return !SH_RESUME;
 
-        // Return false to inform for failure
+    }
+    strcpy( ck->path, real );
+    strcat( ck->path, CKPT_JOURNAL_EXT );
+    free( real );
+
+    // Resume
+    if ( SH_RESUME && !sh_ckpt_load( ck, &st ) ) {
+        free( ck->path );
+        free( ck->ok );
+        ck->path = NULL;
         return false;
-
     }
 
-    // Child process execs command via execvp()
-    if ( pid == 0 ) {
+    // Continue the interrupted run's journal ( unless another run holds it )
+    if ( NULL != ck->ok ) {
 
-        // Execute shell command with args
-        execvp( cmd->cmd, cmd->args );
+        ck->fd = sh_ckpt_lock( ck, 0 );
+        if ( ck->fd < 0 && EWOULDBLOCK == errno ) {
 
-        // If reaches here, means an error occured
-        fprintf( stdout, "\t@sh_exec(): execvp returned: %s\n", strerror( errno ) );
-
-        // Return failure
-        _exit( EXIT_FAILURE );
+            // Report error
+            fprintf( stdout, "\t@mode_b(): --resume: %s is in use by another run\n", ck->path );
 
-        // Parent process waits for child to finish while reading output from pipe
-    } else {
+            // Free resources
+            free( ck->path );
+            free( ck->ok );
+            ck->path = NULL;
+            ck->ok = NULL;
 
-        // Get child status (upon return)
-        int status = 0;
+            // Return failure
+            return false;
 
-        // Wait for child with pid = cpid
-        // Both WNOHANG, WUNTRACED are disabled, since we want blocking operation and job run in foreground
-        waitpid( pid, &status, 0 );
+        }
 
-        // After child's execution
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_exec(): -- child [pid = %d] finished with status: %d\n", pid, status );
+        // DEBUGGING:
+        if ( ck->fd < 0 && SH_DBG( 1 ) )
+            fprintf( stdout, "\t@sh_ckpt_open(): %s: not journaling: %s\n", ck->path, strerror( errno ) );
 
-        // Return execution result
-        return EXIT_SUCCESS == status;
+        return true;
 
     }
 
+    // Start a new one ( header only, until the first sync )
+    len = snprintf( ck->buf, CKPT_BUF_LEN, "chsh-ckpt %lld %lld %lld\n", ( long long ) st.st_size,
+                    ( long long ) st.st_mtim.tv_sec, ( long long ) st.st_mtim.tv_nsec );
+    ck->len = ( size_t ) len;
+    ck->pending = true;
+
+    return true;
+
 }
 /*
- * Built-in command execution
+ * Check if a batch file's row succeeded in the interrupted run ( --resume ) and need not run again
  *
- * When a built-in command needs to be executed, it has to be executed on the main process.
- * But here we reach via sh_exec() and one of its children. Therefore, we have to use a shared memory strategy
- * in order to move the whole command from current process to the main process. When transfer complete, we send
- * a signal to the main process to process command.
+ * @param line [size_t]: The row's index in the batch file
+ * @param row [string]: The row ( not NULL-terminated )
+ * @param len [size_t]: Length of $row
  */
-bool sh_exec_builtin ( sh_cmd_t *cmd ) {
-
-    // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, "\t@sh_exec_builtin(%d): executing builtin command: %s\n", getpid(), cmd->cmd );
-
-    //Vars
-    pid_t pid;                  // the entered process id
-    size_t temp, add, i;
-    struct sigaction sigact;    // the sigaction of current process
-    sigset_t sig_block_set;     // the set of enabled signals ( negative logic )
-    bool result;                // the execution result from main process
+bool sh_ckpt_skip ( const sh_ckpt_t *ck, size_t line, const char *row, size_t len ) {
 
-    // If built-in command can be run by any process ( e.g. reading an env variable )
-    // then we should run it here
-    if ( !cmd->bltcmd->run_in_main_process ) {
+    // Vars
+    sh_row_t prow;
+    sh_mark_t mark;
+    bool skip;
 
-        // Execute built-in command's associated function
-        // The struct sh_bltcmd_t defines two fields: the command name and a function
-        result = cmd->bltcmd->exec( cmd );
+    if ( line >= ck->nok || 0 == ( *( ck->ok + line / 8 ) & ( 1u << line % 8 ) ) ) return false;
 
-    } else {
+    // Rows changing the shell's state run again
+    mark = sh_arena_mark( &SH_ARENA );
+    skip = sh_row_load( row, len, &prow, true ) && !sh_row_stateful( &prow );
+    sh_arena_release( &SH_ARENA, mark );
 
-        // else execute command in main process by saving command in shared memory
-        // and exchange hand-shaking signals with main process
+    // DEBUGGING:
+    if ( skip && SH_DBG( 1 ) )
+        fprintf( stdout, "\t@sh_ckpt_skip(): succeeded before, skipping: '%.*s'\n", ( int ) len, row );
 
-        // Init
-        pid = getpid();
-        add = 0;
+    return skip;
 
-        /*
-         * -----------------------------------------------------
-         * Transmission Protocol
-         * -----------------------------------------------------
-         *
-         * The sent data stored in memory are the following:
-         *  - [pid_t]:      pid
-         *  - [size_t]:     strlen(cmd)
-         *  - [char *]      cmd
-         *  - [size_t]:     nargs
-         *  - [size_t]:     strlen(arg{0})
-         *  - [char *]      arg{0}
-         *  - [size_t]:     strlen(arg{1})
-         *  - [char *]      arg{1}
-         *  -        ...
-         *  - [size_t]:     strlen(arg{n-1})
-         *  - [char *]      arg{n-1}
-         *  - [size_t]:     strlen(glue_b)
-         *  - [char *]      glue_b
-         *  - [size_t]:     strlen(glue_a)
-         *  - [char *]      glue_a
-         *  - [bool]:       is_blt
-         *  - [bltcmd]      bltcmd
-         *
-         * The response data stored in memory are the following:
-         *  - [bool]:       result
-         *  - [size_t];     strlen(msg)
-         *  - [char *]:     msg
-         *
-         * -----------------------------------------------------
-         *
-         */
-        // pid
-        memcpy( SH_SHARED_MEMORY_PTR + add, &pid, sizeof( pid_t ) );
-        add += sizeof( pid_t );
-        // strlen(cmd)
-        temp = strlen( cmd->cmd ) + 1;
-        memcpy( SH_SHARED_MEMORY_PTR + add, &temp, sizeof( size_t ) );
-        add += sizeof( size_t );
-        // cmd
-        memcpy( SH_SHARED_MEMORY_PTR + add, cmd->cmd, temp * sizeof( char ) );
-        add += temp * sizeof( char );
-        // nargs
-        temp = cmd->nargs;
-        memcpy( SH_SHARED_MEMORY_PTR + add, &temp, sizeof( size_t ) );
-        add += temp * sizeof( size_t );
-
-        // args
-        for ( i = 0; i < cmd->nargs - 1; ++i ) {
-
-            // strlen( arg( i ) )
-            temp = strlen( *( cmd->args + i ) ) + 1;
-            memcpy( SH_SHARED_MEMORY_PTR + add, &temp, sizeof( size_t ) );
-            add += temp * sizeof( size_t );
-
-            // arg( i )
-            memcpy( SH_SHARED_MEMORY_PTR + add, *( cmd->args + i ), temp * sizeof( char ) );
-            add += temp * sizeof( char );
-
-        }
-
-        // strlen(glue_b)
-        temp = strlen( cmd->glue_b ) + 1;
-        memcpy( SH_SHARED_MEMORY_PTR + add, &temp, sizeof( size_t ) );
-        add += sizeof( size_t );
-        // glue_b
-        memcpy( SH_SHARED_MEMORY_PTR + add, cmd->glue_b, temp * sizeof( char ) );
-        add += temp * sizeof( char );
-        // strlen(glue_a)
-        temp = strlen( cmd->glue_a ) + 1;
-        memcpy( SH_SHARED_MEMORY_PTR + add, &temp, sizeof( size_t ) );
-        add += sizeof( size_t );
-        // glue_a
-        memcpy( SH_SHARED_MEMORY_PTR + add, cmd->glue_a, temp * sizeof( char ) );
-        add += temp * sizeof( char );
-        // is_blt
-        memcpy( SH_SHARED_MEMORY_PTR + add, &cmd->is_blt, sizeof( bool ) );
-        add += sizeof( bool );
-        // bltcmd
-        memcpy( SH_SHARED_MEMORY_PTR + add, cmd->bltcmd, sizeof( sh_bltcmd_t ) );
-
-        // Send a SIGUSR2 signal to main process to inform about executing built-in command
-        // Wait here until main process responds with SIGUSR
-        signal( SIGUSR2, SIG_IGN );
-        kill( SH_PID, SIGUSR2 );
+}
+/*
+ * Journal a finished row
+ *
+ * @param line [size_t]: The row's index in the batch file
+ * @param ok [bool]: The row's result
+ */
+void sh_ckpt_done ( sh_ckpt_t *ck, size_t line, bool ok ) {
 
-        /*
-         * ------------
-         * Signal Setup
-         * ------------
-         *
-         */
-        sigfillset( &sig_block_set );
-        sigdelset( &sig_block_set, SIGUSR1 );
+    // Vars
+    struct timespec now;
+    int n;
 
-        sigemptyset( &sigact.sa_mask );     // clears all signals
-        sigact.sa_flags = 0;                // no special flag needed
-        sigact.sa_handler = sh_SIGIGN_handler;        // set the handler ( dummy )
-        sigaction( SIGUSR1, &sigact, NULL );
+    if ( ck->fd < 0 && !ck->pending ) return;
 
-        // Wait for response signal
-        sigsuspend( &sig_block_set );
+    // Append record ( making room first )
+    if ( ck->len + 32 > CKPT_BUF_LEN ) sh_ckpt_sync( ck );
+    if ( ck->fd < 0 && !ck->pending ) return;
+    n = snprintf( ck->buf + ck->len, CKPT_BUF_LEN - ck->len, "%zu %c\n", line, ok ? 'o' : 'f' );
+    ck->len += ( size_t ) n;
 
-        // Inform that you' ve received response
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@sh_exec_builtin(): main process finished executing command\n" );
+    // Sync group ( the first failed row creates the journal )
+    if ( ++ck->nrec < CKPT_SYNC_ROWS && ( ok || !ck->pending ) ) {
 
-        // Get result
-        memcpy( &result, SH_SHARED_MEMORY_PTR, sizeof( bool ) );
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        if ( ( now.tv_sec - ck->synced.tv_sec ) * 1000 + ( now.tv_nsec - ck->synced.tv_nsec ) / 1000000 <
+             CKPT_SYNC_MS )
+            return;
 
     }
-
-    // Return execution result
-    return result;
+    sh_ckpt_sync( ck );
 
 }
-
-/*
- * ----------------
- * Operation Modes
- * ----------------
- *
- * 1 ) Interactive Mode
- *    The user inputs single-row commands, the program parses them and executes them in order.
- *
- * 2 ) Batch Mode
- *    The user inputs a filename that contains a batch of single-row commands.
- *    The program parses and executes each row as in interactive mode
- *
- * 3 ) Mixed Mode
- *    The user inputs single-row commands that may contain just the batch file's name.
- *    In that case the program switches to batchmode and after execution of file's commands, returns to interactive mode.
+/*
+ * Stop journaling
  *
+ * @param complete [bool]: All rows of the batch file succeeded ( the journal is removed )
  */
+void sh_ckpt_close ( sh_ckpt_t *ck, bool complete ) {
+
+    // Interrupted: journal what was done ( creating the journal, if needed )
+    if ( !complete && ( ck->fd >= 0 || ck->pending ) ) sh_ckpt_sync( ck );
+
+    // Succeeded: remove the journal ( locked ), this run's or an older run's one
+    if ( complete && ck->pending ) ck->fd = sh_ckpt_lock( ck, 0 );
+    if ( ck->fd >= 0 ) {
+        if ( complete ) unlink( ck->path );
+        close( ck->fd );
+    }
+
+    // Free resources
+    free( ck->path );
+    free( ck->ok );
+
+}
 /*
- *  mode_i() - Interactive Mode
- *
- *  In interactive mode, user enters an one-line command.
- *  The program reads the raw input and parses it to commands to be executed.
- *
- *  @param [bool] mode_m: enable / disable mixed mode
- *  @return [bool]: the overall execution result of all commands given during interactive mode
+ *  mode_b() - Batch Mode
  *
+ *  The batch file is nothing more than a set of sh_row_t rows.
+ *  Thus, we treat batch files as arrays of shell rows.
  */
-bool mode_i ( bool mode_m ) {
+bool mode_b ( const char *bfname ) {
 
     // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, ":| Switched to interactive mode |:\n" );
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, ":| Switched to batch mode |:\n" );
 
     // Vars
-    char *raw, *prompt, *fname;
-    bool result_partial, result_overall;
+    char answer[ROW_LEN_MAX];
+    const char *row;
+    size_t len;
+    bool result_partial, result_overall, parallel, deps, incremental, executing, ahead, eoi;
+    sh_reader_t rd;
+    sh_inc_t inc;
+    sh_ckpt_t ck;
+    sh_aqueue_t aq;
+    sh_ahead_t *item;
+    size_t fp, line;
+    long ncpus;
+    int fd;
 
-    // Init
-    raw = ( char * ) calloc( ROW_LEN_MAX, sizeof( char ) );
-    if ( NULL == raw ) {
+    // Ask if user wants to open file as batch file ( headless shells never ask )
+    if ( SH_HEADLESS ) *answer = 'y';
+    else {
 
-        // Echo error
-        fprintf( stdout, "\t@mode_i(): calloc for $raw failed: %s\n", strerror( errno ) );
+        fprintf( stdout, "%s: would you like to open as a batch file? (y|N): ", bfname );
 
-        // Return failure
-        return false;
+        // Get answer
+        if ( NULL == fgets( answer, ROW_LEN_MAX, stdin ) ) *answer = '\0';
 
     }
 
-    prompt = ( char * ) calloc( strlen( PROMPT_MESSAGE ) + 1, sizeof( char ) );
-    if ( NULL == prompt ) {
-
-        // Echo error
-        fprintf( stdout, "\t@mode_i(): calloc for $prompt failed: %s\n", strerror( errno ) );
+    // Check answer
+    if ( 'y' != *answer && 'Y' != *answer ) {
 
-        // Free resources
-        free( raw );
+        // DEBUGGING:
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\t@mode_b(): %s: user rejected opening file\n", bfname );
 
         // Return failure
         return false;
 
     }
 
-    result_overall = true;
-
-    // Create prompt
-    strcat( prompt, PROMPT_MESSAGE );   // we create prompt message in this way so as for it to be flexible
-
-    // Main shell loop
-    do {
-
-        // Print prompt
-        fprintf( stdout, "%s> ~%s$ ", prompt,
-                 sh_get_env( SH_SHOW_WD_KEY, SH_SHOW_WD_DEFAULT ) || strcmp( SH_WD, SH_WD_I ) != 0 ? SH_WD : "" );
-
-        // Clear the raw buffer
-        memset( raw, '\0', ROW_LEN_MAX );
+    // Open file
+    fd = open( bfname, O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 ) {
 
-        // Get input
-        fgets( raw, ROW_LEN_MAX, stdin );
+        // Report error
+        fprintf( stdout, "\t@mode_b(): %s: error opening file: %s\n", bfname, strerror( errno ) );
 
-        // Remove <lf>
-        *( raw + strlen( raw ) - 1 ) = '\0';
+        // Return failure
+        return false;
 
-        // Check for exit
-        if ( sh_quit( raw ) ) break;
+    }
 
-        // Raise executing flag
-        SH_EXECUTING = true;
+    // Map file ( or read it in blocks, if not a regular file )
+    if ( !sh_reader_init( &rd, fd, true ) ) {
 
-        // Drop SH_FORCE_QUIT flag
-        // needs be off before every command's execution
-        SH_FORCE_QUIT = false;
+        // Free resources
+        close( fd );
 
-        // Parse & execute single-row commands
-        // Check if in mixed mode and file is batch file
-        if ( mode_m ) {
+        // Return failure
+        return false;
 
-            // Check if filename exists
-            fname = mode_m ? sh_file_exists( raw ) : NULL;
+    }
 
-            // Check fname
-            if ( NULL != fname ) {
+    // Rows are run by workers with -j or dependency directives ( main process only, batch files run by a row are
+    // executed sequentially ). Dependencies use all processors, unless -j is given.
+    deps = SH_PID == getpid() && sh_batch_has_deps( &rd );
+    parallel = deps || ( SH_PID == getpid() && SH_JOBS > 1 );
 
-                // If TRUE, ask if should execute file name
-                fprintf( stdout, "\t@mode_i(): %s: execute batch file instead of command-set? [y|N]: ", fname );
+    // Journal finished rows ( main process only ), with --resume skip the ones that succeeded before
+    memset( &ck, 0, sizeof( sh_ckpt_t ) );
+    ck.fd = -1;
+    if ( SH_PID == getpid() && !sh_ckpt_open( &ck, bfname, fd ) ) {
 
-                // Get answer
-                char tempptr[ROW_LEN_MAX];
-                fgets( tempptr, ROW_LEN_MAX, stdin );
+        // Free resources
+        sh_reader_free( &rd );
+        close( fd );
 
-                // Check answer
-                if ( 'y' == *tempptr || 'Y' == *tempptr ) {
+        // Return failure
+        return false;
 
-                    // Execute
-                    result_partial = mode_b( fname );
+    }
 
-                    // Free resources
-                    free( fname );
+    // Load last run's journal ( -i, not with dependency directives )
+    incremental = SH_INCREMENTAL && SH_PID == getpid() && !deps;
+    if ( incremental && !sh_inc_open( &inc, bfname ) ) {
 
-                } else result_partial = sh_parse_exec_row( raw );
+        // Free resources
+        sh_ckpt_close( &ck, false );
+        sh_reader_free( &rd );
+        close( fd );
 
-            } else result_partial = sh_parse_exec_row( raw );
+        // Return failure
+        return false;
 
-        } else result_partial = sh_parse_exec_row( raw );
+    }
 
-        // Drop executing flag
-        SH_EXECUTING = false;
+    // SIGINT stops the file after the running rows ( a second one kills the shell, see sh_sig_int() )
+    executing = SH_EXECUTING;
+    SH_EXECUTING = true;
+    SH_FORCE_QUIT = false;
+
+    ncpus = sysconf( _SC_NPROCESSORS_ONLN );
+    if ( deps ) result_overall = sh_batch_dag( &rd, SH_JOBS > 0 ? SH_JOBS : ncpus > 0 ? ( size_t ) ncpus : 1, &ck );
+    else if ( parallel ) result_overall = sh_batch_parallel( &rd, SH_JOBS, incremental ? &inc : NULL, &ck );
+    else result_overall = true;
+    eoi = rd.eof && rd.beg == rd.end;
+
+    // Sequential rows of a mapped file are parsed ahead by another thread, while the previous ones execute ( with a
+    // single processor the threads would only take turns ). Debugging keeps parsing in row order, messages included
+    ahead = !parallel && rd.map && SH_CONF.parse_ahead > 0 && ncpus > 1 && !SH_DBG( 1 ) &&
+            sh_ahead_start( &aq, &rd, ( size_t ) SH_CONF.parse_ahead );
+    item = NULL;
+
+    // Read rows
+    for ( line = 0; !parallel; line++ ) {
+
+        // Get row ( releasing the previous one )
+        if ( ahead ) {
+            if ( NULL != item ) sh_ahead_pop( &aq );
+            item = sh_ahead_next( &aq );
+            row = item->raw;
+            len = item->len;
+        } else row = sh_reader_next( &rd, &len );
+
+        // Check for end of input or exit
+        if ( NULL == row ) eoi = true;
+        if ( NULL == row || sh_quit( row, len ) ) break;
+
+        // Skip rows that succeeded before ( --resume ) or unchanged since last run ( -i )
+        if ( sh_ckpt_skip( &ck, line, row, len ) ) continue;
+        fp = 0;
+        if ( incremental && sh_inc_skip( &inc, row, len, &fp ) ) {
+            if ( 0 != fp ) sh_ckpt_done( &ck, line, true );
+            continue;
+        }
 
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@mode_i(): command execution finished\n" );
+        // Parse & execute single-row commands
+        result_partial = ahead ? sh_ahead_exec( item ) : sh_parse_exec_row( row, len );
+        if ( result_partial && incremental ) sh_inc_done( &inc, fp );
+        sh_ckpt_done( &ck, line, result_partial );
 
         // Check result
         if ( !result_partial ) {
 
             // Print error
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-                fprintf( stdout, "\t@mode_i(): error executing command-set: '%s'\n", raw );
+            fprintf( stdout, "\t@mode_b(): error executing command-set: '%.*s'\n", ( int ) len, row );
 
             // Assign to result_overall
             if ( result_overall ) result_overall = false;
 
             // Check abort
-            if ( sh_get_env( SH_ON_ROW_ERR_ABRT_KEY, SH_ON_ROW_ERR_ABRT_DEFAULT ) ) break;
+            if ( SH_CONF.on_frow_err_abrt ) break;
 
         }
 
-    } while ( !SH_QUIT );
+        if ( SH_DBG( 1 ) )
+            fprintf( stdout, "\n<-------------------------------->\n\n" );
+
+        // Pending events ( e.g. Ctrl + C ) are noticed while waiting for commands, rows of built-ins never wait
+        if ( 0 == ( line + 1 ) % SIG_POLL_ROWS ) sh_ipc_poll( -1, 0 );
+
+        // Stop if interrupted or a built-in asked to
+        if ( SH_QUIT ) break;
+
+    }
+    if ( ahead ) sh_ahead_stop( &aq );
+    SH_EXECUTING = executing;
+
+    // Interrupted ( rows were left unfinished )
+    if ( SH_FORCE_QUIT ) result_overall = false;
+
+    // Journal succeeded rows for the next run
+    if ( incremental && !sh_inc_close( &inc, eoi ) )
+        result_overall = false;
+
+    // The checkpoint is kept unless the whole file succeeded
+    sh_ckpt_close( &ck, result_overall );
 
     // Free resources
-    free( raw );
-    free( prompt );
+    sh_reader_free( &rd );
+    if ( close( fd ) < 0 ) {
 
-    // Return
+        // Report error
+        fprintf( stdout, "\t@mode_b(): %s: error closing file: %s\n", bfname, strerror( errno ) );
+
+        // Make $result_overall false
+        result_overall = false;
+
+    }
+
+    // Return result of whole file execution
     return result_overall;
+
 }
 
 /*
- *  mode_b() - Batch Mode
+ *  mode_s() - Stream Mode
  *
- *  The batch file is nothing more than a set of sh_row_t rows.
- *  Thus, we treat batch files as arrays of shell rows.
+ *  Rows are read from a non-terminal input ( e.g. a pipe ) in large blocks and executed as in batch mode.
+ *  Commands share the shell's input: the rows the shell has already read ahead are not seen by them.
  */
-bool mode_b ( const char *bfname ) {
+bool mode_s ( int fd ) {
 
     // DEBUGGING:
-    if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-        fprintf( stdout, ":| Switched to batch mode |:\n" );
+    if ( SH_DBG( 1 ) )
+        fprintf( stdout, ":| Switched to stream mode |:\n" );
 
     // Vars
-    char *bfline;
+    sh_reader_t rd;
+    const char *row;
+    size_t len;
     bool result_partial, result_overall;
-    FILE *bfp;
 
     // Init
-    bfline = ( char * ) calloc( ROW_LEN_MAX, sizeof( char ) );
-    if ( NULL == bfline ) {
-
-        // Echo error
-        fprintf( stdout, "\t@mode_b(): calloc for $bfline failed: %s\n", strerror( errno ) );
-
-        // Return failure
-        return false;
-
-    }
+    if ( !sh_reader_init( &rd, fd, false ) ) return false;
+    result_overall = true;
 
-    // Ask if user wants to open file as batch file
-    fprintf( stdout, "%s: would you like to open as a batch file? (y|N): ", bfname );
+    // Read rows
+    while ( NULL != ( row = sh_reader_next( &rd, &len ) ) ) {
 
-    // Get answer
-    fgets( bfline, ROW_LEN_MAX, stdin );
+        // Check for exit
+        if ( sh_quit( row, len ) ) break;
 
-    // Check answer
-    if ( 'y' == *bfline || 'Y' == *bfline ) {
+        // Parse & execute single-row commands
+        result_partial = sh_parse_exec_row( row, len );
 
-        // Open file
-        bfp = fopen( bfname, "r" );
-        if ( bfp == NULL ) {
+        // Check result
+        if ( !result_partial ) {
 
-            // Report error
-            fprintf( stdout, "\t@mode_b(): %s: error opening file: %s\n", bfname, strerror( errno ) );
+            // Print error
+            fprintf( stdout, "\t@mode_s(): error executing command-set: '%.*s'\n", ( int ) len, row );
 
-            // Try closing stream
-            fclose( bfp );
+            // Assign to result_overall
+            if ( result_overall ) result_overall = false;
 
-            // Return failure
-            return false;
+            // Check abort
+            if ( SH_CONF.on_frow_err_abrt ) break;
 
         }
 
-        // Go to file start
-        //rewind( bfp );
+        // Stop if a built-in asked to
+        if ( SH_QUIT ) break;
 
-        // Read lines
-        result_overall = true;
-        while ( fgets( bfline, ROW_LEN_MAX, bfp ) ) {
+    }
 
-            // Remove <lf> if last char
-            if ( '\n' == *( bfline + strlen( bfline ) - 1 ) )
-                *( bfline + strlen( bfline ) - 1 ) = '\0';
+    // Free resources
+    sh_reader_free( &rd );
 
-            // Check for exit
-            if ( sh_quit( bfline ) ) break;
+    // Return result of whole input's execution
+    return result_overall;
 
-            // Parse & execute single-row commands
-            result_partial = sh_parse_exec_row( bfline );
+}
 
-            // Check result
-            if ( !result_partial ) {
+/*
+ * -------
+ * main()
+ * -------
+ *
+ */
+int main ( int argc, char **argv, char **envp ) {
 
-                // Print error
-                fprintf( stdout, "\t@mode_b(): error executing command-set: '%s'\n", bfline );
+    // Vars
+    char *fname;      // The pointer to check if valid batch file name given
+    const char *row;  // The row given with -c
+    sigset_t sigs;
+    int opt;
+    static const struct option lopts[] = {
+            {"resume", no_argument, NULL, 'r'},
+            {NULL, 0,               NULL, 0}
+    };
 
-                // Assign to result_overall
-                if ( result_overall ) result_overall = false;
+    // Init
+    fname = NULL;
+    row = NULL;
 
-                // Check abort
-                if ( sh_get_env( SH_ON_FROW_ERR_ABRT_KEY, SH_ON_FROW_ERR_ABRT_DEFAULT ) ) break;
+    /*
+     * Headless options ( for scripts, cron, CI, ... )
+     *
+     *  -c row:  execute a single row and exit with its status
+     *  -f file: execute a batch file without asking for confirmation
+     *  -i:      skip rows of the batch file that succeeded last time, if unchanged ( see Incremental batch execution )
+     *  --resume: continue an interrupted batch file from its first unfinished row ( see Batch checkpoints )
+     *
+     */
+    while ( -1 != ( opt = getopt_long( argc, argv, "+c:f:ij:", lopts, NULL ) ) ) {
 
-            }
+        switch ( opt ) {
 
-            if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-                fprintf( stdout, "\n<-------------------------------->\n\n" );
+            case 'c':
+                row = optarg;
+                break;
 
-        }
+            case 'f':
+                free( fname );
+                fname = sh_file_exists( optarg );
+                if ( NULL == fname ) {
 
-        // Close file pointer
-        if ( EOF == fclose( bfp ) ) {
+                    // Report error
+                    fprintf( stdout, "\t@main(): '%s' not a valid batch file\n", optarg );
 
-            // Report error
-            fprintf( stdout, "\t@mode_b(): %s: error closing file: %s\n", bfname, strerror( errno ) );
+                    // Exit reporting failure
+                    exit( EXIT_FAILURE );
 
-            // Make $result_overall false
-            result_overall = false;
+                }
+                break;
 
-        }
+            case 'i':
+                SH_INCREMENTAL = true;
+                break;
 
-    } else {
+            case 'r':
+                SH_RESUME = true;
+                break;
 
-        // DEBUGGING:
-        if ( sh_get_env( SH_DBG_MODE_KEY, SH_DBG_MODE_DEFAULT ) >= 1 )
-            fprintf( stdout, "\t@mode_b(): %s: user rejected opening file\n", bfname );
+            case 'j':
+                if ( atoi( optarg ) > 0 ) {
+                    SH_JOBS = ( size_t ) atoi( optarg );
+                    break;
+                }
 
-        // Assign result
-        result_overall = false;
+                // Report error
+                fprintf( stdout, "\t@main(): -j: '%s' not a valid number of jobs\n", optarg );
 
-    }
+                // Exit reporting failure
+                exit( EXIT_FAILURE );
 
-    // Free resources
-    free( bfline );
+            default:
 
-    // Return result of whole file execution
-    return result_overall;
+                // Report error
+                fprintf( stdout, "usage: %s [ -i ] [ -j jobs ] [ --resume ] [ -c row | -f file | file ]\n", *argv );
 
-}
+                // Exit reporting failure
+                exit( EXIT_FAILURE );
 
-/*
- * -------
- * main()
- * -------
- *
- */
-int main ( int argc, char **argv, char **envp ) {
+        }
 
-    // Vars
-    char *fname;      // The pointer to check if valid batch file name given
+    }
+    SH_HEADLESS = NULL != row || NULL != fname;
 
     // Set fname to the possible batch file's name, given in argv
-    fname = argc == 1 || NULL == *( argv + 1 ) ? NULL : sh_file_exists( *( argv + 1 ) );
+    if ( !SH_HEADLESS )
+        fname = optind >= argc ? NULL : sh_file_exists( *( argv + optind ) );
 
     // Set main() process id
     SH_PID = getpid();
 
     // Choose SH_MODE
-    if ( argc == 1 || NULL == fname ) {
+    if ( SH_HEADLESS ) {
+
+        /*
+         * ===============
+         *  HEADLESS MODE
+         * ===============
+         *
+         * No terminal setup: a single row ( -c wins over -f ) or a batch file is executed
+         *
+         */
+        SH_MODE = NULL != row ? 'c' : 'b';
+
+    } else if ( NULL == fname ) {
 
         /*
          * ==================
@@ -3124,11 +6676,16 @@ int main ( int argc, char **argv, char **envp ) {
 
         } else {
 
-            // Failed creating process group in order to start INTERACTIVE mode
-            fprintf( stdout, "\t@main(): error creating process group for chshell: %s\n", strerror( errno ) );
-
-            // Exit reporting failure
-            exit( EXIT_FAILURE );
+            /*
+             * =============
+             *  STREAM MODE
+             * =============
+             *
+             * Input is not a terminal ( e.g. a pipe ): rows are read from stdin, with no terminal setup
+             *
+             */
+            SH_MODE = 's';
+            SH_HEADLESS = true;
 
         }
 
@@ -3150,44 +6707,19 @@ int main ( int argc, char **argv, char **envp ) {
     /*
      * Signals setup
      *
-     * main process listens to SIGUSR2, SIGINT, SIGCHLD
+     * main process listens to SIGINT, SIGCHLD: they are blocked and read as events ( see sh_ipc_init() ), children
+     * get the previous mask back ( see sh_fork() )
      *
      */
-    // The SIGUSR2 signal informs about executing a builtin command
-    if ( SIG_ERR == signal( SIGUSR2, sh_SIGUSR2_handler ) ) {
-
-        // Report error
-        fprintf( stdout, "\t@main(): attaching to SIGUSR2 not honored: %s\n", strerror( errno ) );
-
-        // Free resources
-        free( SH_WD );
-        free( SH_WD_I );
-
-        // Exit reporting failure
-        exit( EXIT_FAILURE );
-
-    }
-
-    // When Ctrl + C is pressed: show bye screen and exit
-    if ( SIG_ERR == signal( SIGINT, sh_SIGINT_handler ) ) {
-
-        // Report error
-        fprintf( stdout, "\t@main(): attaching to SIGINT not honored: %s\n", strerror( errno ) );
-
-        // Free resources
-        free( SH_WD );
-        free( SH_WD_I );
-
-        // Exit reporting failure
-        exit( EXIT_FAILURE );
-
-    }
-
-    // When child process exits, check for leftovers
-    if ( SIG_ERR == signal( SIGCHLD, sh_SIGCHLD_handler ) ) {
+    sigemptyset( &sigs );
+    sigaddset( &sigs, SIGINT );     // when Ctrl + C is pressed: show bye screen and exit
+    sigaddset( &sigs, SIGCHLD );    // when child process exits, check for leftovers
+    if ( sigprocmask( SIG_BLOCK, &sigs, &SH_SIGMASK ) < 0 || 0 != posix_spawnattr_init( &SH_SPAWNATTR ) ||
+         0 != posix_spawnattr_setsigmask( &SH_SPAWNATTR, &SH_SIGMASK ) ||
+         0 != posix_spawnattr_setflags( &SH_SPAWNATTR, POSIX_SPAWN_SETSIGMASK ) ) {
 
         // Report error
-        fprintf( stdout, "\t@main(): attaching to SIGCHLD not honored: %s\n", strerror( errno ) );
+        fprintf( stdout, "\t@main(): blocking SIGINT, SIGCHLD not honored: %s\n", strerror( errno ) );
 
         // Free resources
         free( SH_WD );
@@ -3250,29 +6782,25 @@ int main ( int argc, char **argv, char **envp ) {
     sh_set_env( SH_ON_ROW_ERR_ABRT_KEY, SH_ON_ROW_ERR_ABRT_DEFAULT );
     sh_set_env( SH_ON_FROW_ERR_ABRT_KEY, SH_ON_FROW_ERR_ABRT_DEFAULT );
     sh_set_env( SH_ON_CMD_FAIL_SEARCH_BF_KEY, SH_ON_CMD_FAIL_SEARCH_BF_DEFAULT );
+    sh_set_env( SH_DIRECT_OUT_KEY, sh_get_env( SH_DIRECT_OUT_KEY, SH_DIRECT_OUT_DEFAULT ) );   // kept if inherited
+    sh_set_env( SH_SPAWN_MODE_KEY, sh_get_env( SH_SPAWN_MODE_KEY, SH_SPAWN_MODE_DEFAULT ) );   // kept if inherited
+    sh_set_env( SH_PLAN_CACHE_KEY, sh_get_env( SH_PLAN_CACHE_KEY, SH_PLAN_CACHE_DEFAULT ) );   // kept if inherited
+    sh_set_env( SH_PARSE_AHEAD_KEY, sh_get_env( SH_PARSE_AHEAD_KEY, SH_PARSE_AHEAD_DEFAULT ) ); // kept if inherited
+    sh_conf_sync( NULL );
 
     /*
      * Setup built-in command execution
      *
-     * In particular we need to allocate shared memory and save the pointer.
-     * The space we allocate is the space for one sh_cmd_t object + the size of pid_t to save the pid at the beginning.
-     * UPDATE: since the size of sh_cmd_t object is unknown we allocate SHM_LEM_MAX memory and we use a transmission
-     * protocol to transfer object to shared memory's space.
+     * Built-in commands executed by children that must run in the main process are sent over a channel created
+     * here, before any child process exists ( see sh_ipc_request() ).
      */
-    SH_SHARED_MEMORY_PTR = mmap( 0, SHM_LEN_MAX, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
-    if ( NULL == SH_SHARED_MEMORY_PTR ) {
+    if ( !sh_ipc_init() ) {
 
         // Report error
-        fprintf( stdout, "\t@main(): mmap failed allocating %d bytes of shared memory: %s\n", SHM_LEN_MAX,
-                 strerror( errno ) );
-
-        // Free resources
-        if ( 'm' == SH_MODE ) {
-
-            free( SH_WD );
-            free( SH_WD_I );
+        fprintf( stdout, "\t@main(): built-in command requests' channel could not be created\n" );
 
-        }
+        // Exit reporting failure
+        exit( EXIT_FAILURE );
 
     }
 
@@ -3299,19 +6827,21 @@ int main ( int argc, char **argv, char **envp ) {
     }
 
     // Setup $cmdutils
-    cmdutils->trim = sh_cmd_trim;
     cmdutils->parse = sh_cmd_parse;
     cmdutils->inspect = sh_cmd_inspect;
     cmdutils->isvalid = sh_cmd_isvalid;
     cmdutils->isempty = sh_cmd_isempty;
 
     // Setup $rowutils
-    rowutils->trim = sh_row_trim;
     rowutils->iscomment = sh_row_iscomment;
     rowutils->parse = sh_row_parse;
     rowutils->inspect = sh_row_inspect;
     rowutils->exec = sh_row_exec;
 
+    // Setup row scanner and built-in commands' index
+    sh_scan_init();
+    sh_blt_init();
+
 
     /*
      * ===================================
@@ -3319,22 +6849,27 @@ int main ( int argc, char **argv, char **envp ) {
      * ===================================
      */
 
-    // FIX @ ( CLion's delay 'd display of stderr ):
-    // Redirect stderr to /dev/null ( hide stderr )
-    freopen( "/dev/null", "w", stderr );
+    // Headless shells keep stderr and print nothing of their own
+    if ( !SH_HEADLESS ) {
 
-    // Clear screen
-    if ( SH_MODE != 'b' ) sh_cls();
+        // FIX @ ( CLion's delay 'd display of stderr ):
+        // Redirect stderr to /dev/null ( hide stderr )
+        freopen( "/dev/null", "w", stderr );
 
-    // Print welcome screen
-    sh_prt_welcome();
+        // Clear screen
+        if ( SH_MODE != 'b' ) sh_cls();
+
+        // Print welcome screen
+        sh_prt_welcome();
+
+    }
 
     // Check if file was declared but rejected
-    if ( SH_MODE != 'b' && argc > 1 ) {
+    if ( !SH_HEADLESS && SH_MODE != 'b' && optind < argc ) {
 
         // Report error
         fprintf( stdout, "\t@main(): batch mode could not be initiated: '%s' not a valid batch file\n",
-                 NULL != *( argv + 1 ) ? *( argv + 1 ) : "(null)\n" );
+                 *( argv + optind ) );
 
     }
 
@@ -3343,17 +6878,26 @@ int main ( int argc, char **argv, char **envp ) {
     SH_EXECUTING = false;
 
     // Init execution based on mode
-    SH_STATUS = 'b' == SH_MODE ? mode_b( fname ) : mode_i( true );
+    if ( 'c' == SH_MODE ) SH_STATUS = sh_parse_exec_row( row, strlen( row ) );
+    else if ( 's' == SH_MODE ) SH_STATUS = mode_s( STDIN_FILENO );
+    else SH_STATUS = 'b' == SH_MODE ? mode_b( fname ) : mode_i( true );
 
     // Print end screen
-    sh_prt_bye();
+    if ( !SH_HEADLESS ) sh_prt_bye();
 
     // Free resources
-    munmap( SH_SHARED_MEMORY_PTR, SHM_LEN_MAX );
+    close( SH_IPC_FD[ READ_EDGE ] );
+    close( SH_IPC_FD[ WRITE_EDGE ] );
+    close( SH_EPOLL_FD );
+    close( SH_SIG_FD );
+    posix_spawnattr_destroy( &SH_SPAWNATTR );
     free( SH_WD_I );
     free( cmdutils );
     free( rowutils );
-    if ( 'b' == SH_MODE ) free( fname );
+    sh_plan_flush();
+    sh_job_flush();
+    sh_arena_free( &SH_ARENA );
+    free( fname );
 
     // Exit with success / failure
     exit( SH_STATUS ? EXIT_SUCCESS : EXIT_FAILURE );
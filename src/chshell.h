@@ -46,11 +46,15 @@
  *
  */
 
+#define _GNU_SOURCE         // splice()
+
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <zconf.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <signal.h>
 #include <wait.h>
@@ -58,6 +62,21 @@
 #include <termios.h>
 #include <sys/prctl.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <spawn.h>
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
 #include "termcap/src/termcap.h"
 
 /*
@@ -76,9 +95,52 @@
 // Length definitions
 #define ROW_LEN_MAX 512     // maximum length of a single row in shell
 #define ARG_LEN_MAX 50      // maximum length of command's individual argument
-#define BUF_LEN_MAX 4096    // the output buffer ( same as max pipe size )
+#define BUF_LEN_MAX 65536   // the output collector's chunk ( same as default pipe capacity )
 #define DIR_LEN_MAX 1024    // maximum length of cwd
-#define SHM_LEN_MAX 1024    // 1KB
+#define RD_BLK_LEN 1048576  // size of the blocks read() by the row reader ( grows for longer rows )
+#define PATH_IDX_LEN 256    // initial number of slots in the PATH index ( must be a power of 2 )
+#define BLT_IDX_BITS 6      // the built-in commands' index has 1 << BLT_IDX_BITS slots ( more than built-ins )
+#define JOB_IDX_LEN 64      // initial number of slots in the jobs' pid index ( must be a power of 2 )
+#define ARENA_CHUNK_LEN 16384   // default size of an arena's chunk
+#define ARENA_KEEP_LEN 1048576  // chunks kept for reuse when an arena is emptied ( the rest are freed )
+#define ARENA_ALIGN 16          // alignment of every arena allocation ( power of 2 )
+
+// Incremental batch execution ( -i ): fingerprints of succeeded rows are kept next to the batch file
+#define INC_JOURNAL_EXT ".chsh-inc"
+
+// Batch checkpoints: finished rows are journaled next to the batch file, synced every CKPT_SYNC_ROWS rows or
+// CKPT_SYNC_MS milliseconds, whichever comes first ( the journal is created by the first sync, see sh_ckpt_open() )
+#define CKPT_JOURNAL_EXT ".chsh-ckpt"
+#define CKPT_SYNC_ROWS 4096
+#define CKPT_SYNC_MS 1000
+#define CKPT_BUF_LEN 8192   // journal records not written yet ( flushed when full )
+
+// Event loop: events handled per epoll_wait(), rows of a batch file between checks for pending events
+#define EPOLL_EVS_LEN 8
+#define SIG_POLL_ROWS 256
+
+// Row scanner's block: bytes classified per step ( vector width, 32 for the table lookup fallback )
+#if defined( __AVX2__ )
+#define SH_SCAN_W 32
+#define sh_vec_t __m256i
+#define sh_vec_set1( c ) _mm256_set1_epi8( c )
+#define sh_vec_load( p ) _mm256_loadu_si256( ( const __m256i * ) ( p ) )
+#define sh_vec_eq( a, b ) _mm256_cmpeq_epi8( a, b )
+#define sh_vec_or( a, b ) _mm256_or_si256( a, b )
+#define sh_vec_zero() _mm256_setzero_si256()
+#define sh_vec_mask( a ) ( uint32_t ) _mm256_movemask_epi8( a )
+#elif defined( __SSE2__ )
+#define SH_SCAN_W 16
+#define sh_vec_t __m128i
+#define sh_vec_set1( c ) _mm_set1_epi8( c )
+#define sh_vec_load( p ) _mm_loadu_si128( ( const __m128i * ) ( p ) )
+#define sh_vec_eq( a, b ) _mm_cmpeq_epi8( a, b )
+#define sh_vec_or( a, b ) _mm_or_si128( a, b )
+#define sh_vec_zero() _mm_setzero_si128()
+#define sh_vec_mask( a ) ( uint32_t ) _mm_movemask_epi8( a )
+#else
+#define SH_SCAN_W 32
+#endif
 
 // SH_DBG_MODE is the main debugging control variable
 // 0: no debugging messages
@@ -88,6 +150,14 @@
 #define SH_DBG_MODE_DEFAULT 0
 #define SH_DBG_MODE_KEY "SH_DBG_MODE"
 
+// SH_TRACE_LEVEL is the highest debugging level compiled in ( Makefile's TRACE variable )
+// Messages above it are removed at compile time, regardless of SH_DBG_MODE ( 0 for release builds )
+#ifndef SH_TRACE_LEVEL
+#define SH_TRACE_LEVEL 3
+#endif
+// The parser thread never prints debugging messages ( nor reads $SH_CONF, which the main thread may be setting )
+#define SH_DBG( level ) ( SH_TRACE_LEVEL >= ( level ) && !SH_DBG_MUTE && SH_CONF.dbg_mode >= ( level ) )
+
 // Show working directory
 #define SH_SHOW_WD_DEFAULT 0
 #define SH_SHOW_WD_KEY "SH_SHOW_WD"
@@ -105,6 +175,26 @@
 #define SH_ON_CMD_FAIL_SEARCH_BF_DEFAULT 0
 #define SH_ON_CMD_FAIL_SEARCH_BF_KEY "SH_ON_CMD_FAIL_SEARCH_BF"
 
+// Last command of a command-set writes directly to shell's stdout ( no output collector process )
+// 0: only single commands ( no pipes )
+// 1: all command-sets
+#define SH_DIRECT_OUT_DEFAULT 0
+#define SH_DIRECT_OUT_KEY "SH_DIRECT_OUT"
+
+// Process creation backend for external commands
+// 0: fork() + execv()
+// 1: posix_spawn() ( redirections are expressed as spawn file actions )
+#define SH_SPAWN_MODE_DEFAULT 0
+#define SH_SPAWN_MODE_KEY "SH_SPAWN_MODE"
+
+// Number of parsed rows kept by the plan cache ( 0 disables it )
+#define SH_PLAN_CACHE_DEFAULT 64
+#define SH_PLAN_CACHE_KEY "SH_PLAN_CACHE"
+
+// Rows of a batch file parsed ahead of execution by the look-ahead thread ( 0 disables it )
+#define SH_PARSE_AHEAD_DEFAULT 64
+#define SH_PARSE_AHEAD_KEY "SH_PARSE_AHEAD"
+
 /*
  * -------------
  * Define types
@@ -116,6 +206,38 @@ typedef struct sh_cmd_t sh_cmd_t;
 typedef struct sh_bltcmd_t sh_bltcmd_t;
 typedef struct sh_rowops_t sh_rowops_t;
 typedef struct sh_cmdops_t sh_cmdops_t;
+typedef struct sh_pathent_t sh_pathent_t;
+typedef struct sh_pathidx_t sh_pathidx_t;
+typedef struct sh_conf_t sh_conf_t;
+typedef struct sh_confvar_t sh_confvar_t;
+typedef struct sh_tok_t sh_tok_t;
+typedef struct sh_scmd_t sh_scmd_t;
+typedef struct sh_scan_t sh_scan_t;
+typedef struct sh_chunk_t sh_chunk_t;
+typedef struct sh_arena_t sh_arena_t;
+typedef struct sh_mark_t sh_mark_t;
+typedef struct sh_node_t sh_node_t;
+typedef struct sh_planent_t sh_planent_t;
+typedef struct sh_plancache_t sh_plancache_t;
+typedef struct sh_reader_t sh_reader_t;
+typedef struct sh_brow_t sh_brow_t;
+typedef struct sh_dagrow_t sh_dagrow_t;
+typedef struct sh_inc_t sh_inc_t;
+typedef struct sh_ckpt_t sh_ckpt_t;
+typedef struct sh_ahead_t sh_ahead_t;
+typedef struct sh_aqueue_t sh_aqueue_t;
+typedef struct sh_job_t sh_job_t;
+typedef struct sh_jobtab_t sh_jobtab_t;
+
+// Operators joining commands ( same order as DEL_ARR, SH_OP_NONE ends the row )
+typedef enum sh_op_t {
+    SH_OP_OR, SH_OP_PIPE, SH_OP_AND, SH_OP_BG, SH_OP_SEQ, SH_OP_NONE
+} sh_op_t;
+
+// Byte classes of the row scanner
+enum {
+    SH_CLS_NONE, SH_CLS_CMD, SH_CLS_ROW, SH_CLS_QUOTE, SH_CLS_END
+};
 
 /*
  * -------------
@@ -125,29 +247,61 @@ typedef struct sh_cmdops_t sh_cmdops_t;
  */
 // Utils type
 struct sh_cmdops_t {
-    void ( *trim ) ( sh_cmd_t * );       // pointer to trim function
     bool ( *isempty ) ( sh_cmd_t * );    // pointer to isempty function
     bool ( *isvalid ) ( sh_cmd_t * );    // pointer to isvalid function
     void ( *parse ) ( sh_cmd_t * );      // pointer to parse function
     void ( *inspect ) ( sh_cmd_t * );    // pointer to inspect function
 };
 struct sh_rowops_t {
-    void ( *trim ) ( sh_row_t * );       // pointer to trim function
     bool ( *iscomment ) ( sh_row_t * );  // pointer to iscomment function
     void ( *parse ) ( sh_row_t * );      // pointer to parse function
     void ( *inspect ) ( sh_row_t * );    // pointer to inspect function
     bool ( *exec ) ( sh_row_t * );       // pointer to exec function
 };
 
+// Arena types
+struct sh_chunk_t {
+    sh_chunk_t *next;   // next chunk ( free, if this is the arena's current chunk )
+    size_t size;        // usable bytes ( they follow the header, aligned )
+    size_t used;        // bytes handed out
+};
+struct sh_arena_t {
+    sh_chunk_t *head;   // first chunk
+    sh_chunk_t *cur;    // chunk allocations are served from
+};
+struct sh_mark_t {
+    sh_chunk_t *chunk;  // current chunk when the mark was taken ( NULL: empty arena )
+    size_t used;        // bytes used in $chunk when the mark was taken
+};
+
+// Scanner types ( slices are offsets into the scanned string )
+struct sh_tok_t {
+    size_t off;     // argument's first byte ( quotes excluded )
+    size_t len;     // argument's length
+};
+struct sh_scmd_t {
+    size_t off;     // command's first byte
+    size_t len;     // command's length ( surrounding delimiters excluded )
+    size_t tok;     // index of command's first argument in $toks
+    size_t ntoks;   // number of command's arguments ( command's name included )
+    sh_op_t op;     // operator that ends the command
+};
+struct sh_scan_t {
+    sh_tok_t *toks;     // arguments of all commands, in row order
+    size_t ntoks;       // number of arguments
+    sh_scmd_t *cmds;    // non-empty commands, in row order ( same allocation as $toks )
+    size_t ncmds;       // number of commands
+};
+
 // Command type
 struct sh_cmd_t {
     char *cmd;      // command's name
-    char **args;    // command's arguments array
+    char **args;    // command's arguments array ( pointing in the row's buffer )
     size_t nargs;   // number of arguments in command ( +2: first is command's name and last is NULL )
 
     // Glues
-    char *glue_b;   // the glue between command and previous
-    char *glue_a;   // the glue between command and next
+    const char *glue_b; // the glue between command and previous
+    const char *glue_a; // the glue between command and next
 
     // Props
     bool is_prs;    // is parsed flag
@@ -162,14 +316,181 @@ struct sh_bltcmd_t {
     bool ( *exec ) ( const sh_cmd_t * ); // pointer to the associated function to be executed
 };
 
+// PATH index types
+struct sh_pathent_t {
+    char *cmd;      // command's name ( the hash key, NULL if slot is free )
+    char *path;     // resolved absolute path ( NULL if command was not found in any PATH directory )
+    size_t hash;    // hash of $cmd
+};
+struct sh_pathidx_t {
+    char *env;                  // copy of $PATH the index was built against
+    char *buf;                  // copy of $PATH split in directories ( $dirs point inside )
+    size_t ndirs;               // number of directories in $PATH
+    char **dirs;                // $PATH directories
+    struct timespec *mtimes;    // mtime of each directory when the index was built
+    char *wd;                   // working directory relative directories were resolved in ( NULL if none )
+    size_t nslots;              // number of hash slots ( power of 2 )
+    size_t nused;               // number of occupied slots
+    sh_pathent_t *slots;        // open addressing hash table
+};
+
+// Row reader type ( rows are $buf[ $beg, <lf> ), the unread part is $buf[ $end, $cap ) )
+struct sh_reader_t {
+    int fd;         // input's descriptor
+    char *buf;      // read blocks, or the whole mapped file
+    size_t cap;     // size of $buf
+    size_t beg;     // start of next row
+    size_t pos;     // where the search for next <lf> continues
+    size_t end;     // end of data read so far
+    bool eof;       // no more data in $fd
+    bool map;       // $buf is $fd mapped in memory
+};
+
+// Parallel batch row type ( a row run by a worker process, see mode_b() )
+struct sh_brow_t {
+    pid_t pid;      // worker's pid
+    int out[2];     // worker's stdout, stderr ( unlinked temporary files )
+    bool done;      // worker has terminated
+    bool ok;        // row executed successfully
+    size_t fp;      // row's fingerprint ( -i, 0 if not recorded )
+    size_t line;    // row's index in the batch file ( counting all rows )
+};
+
+// Batch DAG row type ( a row with its prerequisites and successors, see sh_batch_dag() )
+struct sh_dagrow_t {
+    const char *raw;    // row ( slice of the mapped batch file )
+    size_t len;         // length of $raw
+    size_t line;        // row's index in the batch file ( counting all rows )
+    const char *label;  // row's label ( slice, NULL if none )
+    size_t llen;        // length of $label
+    size_t nwait;       // prerequisites not finished yet
+    size_t succ;        // first successor in the successors' array
+    size_t nsucc;       // number of successors
+    pid_t pid;          // worker's pid ( while running )
+    int out[2];         // worker's stdout, stderr ( while running )
+    char state;         // 'w': waiting | 'r': running | 'o': succeeded | 'f': failed | 's': skipped
+};
+
+// Incremental batch execution type ( see sh_inc_open() )
+struct sh_inc_t {
+    char *path;         // journal's path ( absolute batch file's path + INC_JOURNAL_EXT )
+    size_t *slots;      // fingerprints of the last run's succeeded rows ( 0 if free, power of 2 number of slots )
+    size_t nslots;      // number of slots
+    size_t *done;       // fingerprints of this run's succeeded ( or skipped ) rows
+    size_t ndone;       // number of fingerprints in $done
+    size_t cap;         // capacity of $done
+    size_t inputs;      // fingerprint of the inputs declared for the next row ( 0 if none )
+    bool missing;       // an input declared for the next row does not exist
+    size_t nskip;       // rows skipped
+};
+
+// Batch checkpoint journal type ( see sh_ckpt_open() )
+struct sh_ckpt_t {
+    char *path;                 // journal's path ( absolute batch file's path + CKPT_JOURNAL_EXT )
+    int fd;                     // journal, opened for appending and locked ( -1 if not journaling or not created yet )
+    bool pending;               // the journal is created by the next sync ( header and records are in $buf )
+    char buf[CKPT_BUF_LEN];     // records not written yet
+    size_t len;                 // length of $buf
+    size_t nrec;                // records since last sync
+    struct timespec synced;     // time of last sync
+    unsigned char *ok;          // --resume: bitmap of rows that succeeded before ( by index, NULL if none )
+    size_t nok;                 // number of bits in $ok
+};
+
+// Job table types ( background command-sets of the main process, see sh_job_add() )
+struct sh_job_t {
+    pid_t pid;      // job's process, leader of its own process group ( 0 if the job id is free )
+    char state;     // 'r': running | 's': stopped | 'd': done
+    int status;     // wait status ( when done )
+    char *cmd;      // job's command-set ( for listings )
+};
+struct sh_jobtab_t {
+    sh_job_t *jobs;     // job n is $jobs[ n - 1 ]
+    size_t cap;         // capacity of $jobs
+    size_t njobs;       // highest job id in use ( 0 if none )
+    size_t nlive;       // jobs not done yet
+    size_t cur;         // current job ( '+', the most recently started or stopped, 0 if none )
+    size_t *slots;      // pid index: 1 + index in $jobs ( 0 if free, power of 2 number of slots )
+    size_t nslots;      // number of slots
+};
+
+// Runtime configuration types
+struct sh_conf_t {
+    int dbg_mode;               // $SH_DBG_MODE
+    int show_wd;                // $SH_SHOW_WD
+    int on_row_err_abrt;        // $SH_ON_ROW_ERR_ABRT
+    int on_frow_err_abrt;       // $SH_ON_FROW_ERR_ABRT
+    int on_cmd_fail_search_bf;  // $SH_ON_CMD_FAIL_SEARCH_BF
+    int direct_out;             // $SH_DIRECT_OUT
+    int spawn_mode;             // $SH_SPAWN_MODE
+    int plan_cache;             // $SH_PLAN_CACHE
+    int parse_ahead;            // $SH_PARSE_AHEAD
+};
+struct sh_confvar_t {
+    const char *key;    // environment variable's name
+    int def;            // default value
+    int *val;           // field of $SH_CONF that caches the variable
+};
+
+// Execution plan node ( plans are trees of nodes, stored in an array )
+struct sh_node_t {
+    sh_op_t op;     // SH_OP_PIPE: a pipeline, else the operator joining $lhs and $rhs
+    size_t lhs;     // pipeline: its first stage ( index in row's commands ), else left operand's node
+    size_t rhs;     // pipeline: number of stages, SH_OP_BG: number of commands in $lhs, else right operand's node
+};
+
 // Row Type
 struct sh_row_t {
-    char *raw;          // up to ROW_LEN_MAX bytes
+    char *raw;          // trimmed row ( NULL-terminated copy )
     size_t ncmds;       // total commands in row
-    sh_cmd_t *cmds;     // commands array
+    sh_cmd_t *cmds;     // commands array ( same block as the argv arrays and the arguments they point to )
+    sh_scan_t scan;     // scanned commands and arguments of $raw ( in $SH_ARENA, as all of row's memory )
+    sh_node_t *plan;    // execution plan's nodes
+    size_t nnodes;      // number of nodes in $plan
+    size_t root;        // plan's root node ( SIZE_MAX if row has no commands )
     sh_rowops_t *utils; // row utilities
 };
 
+// Plan cache types
+struct sh_planent_t {
+    size_t hash;            // hash of $row.raw ( the trimmed row, which is the key )
+    size_t len;             // length of $row.raw
+    sh_planent_t *chain;    // next entry in the same bucket
+    sh_planent_t *prev;     // more recently used entry
+    sh_planent_t *next;     // less recently used entry
+    sh_row_t row;           // parsed row ( all of its memory follows the entry, see sh_plan_copy() )
+};
+struct sh_plancache_t {
+    size_t cap;                 // maximum number of entries ( $SH_PLAN_CACHE when the buckets were allocated )
+    size_t nused;               // number of entries
+    size_t nbuckets;            // number of buckets ( power of 2 )
+    sh_planent_t **buckets;     // chained hash table
+    sh_planent_t *head;         // most recently used entry
+    sh_planent_t *tail;         // least recently used entry ( evicted first )
+    size_t hits;                // rows found in the cache
+    size_t misses;              // rows parsed and inserted
+};
+
+// Look-ahead parsing types ( see sh_ahead_start() )
+struct sh_ahead_t {
+    const char *raw;    // row ( slice of the mapped batch file, NULL at the end of input )
+    size_t len;         // length of $raw
+    bool parsed;        // $row holds the parsed row ( else it is parsed when executed )
+    sh_row_t row;       // parsed row ( no commands if empty or a comment )
+    char *blk;          // memory of $row ( an image, see sh_plan_copy(), NULL if no commands )
+};
+struct sh_aqueue_t {
+    sh_reader_t *rd;    // the batch file's reader ( owned by the parser thread while it runs )
+    sh_ahead_t *items;  // ring of parsed rows
+    uint32_t cap;       // number of items ( power of 2 )
+    pthread_t tid;      // parser thread
+    bool stop;          // the main thread stops the parser thread
+    uint32_t head __attribute__ ( ( aligned( 64 ) ) );  // next item to execute ( main thread )
+    uint32_t cwait;                                     // main thread waits on $tail ( only it clears the flag )
+    uint32_t tail __attribute__ ( ( aligned( 64 ) ) );  // next item to parse ( parser thread )
+    uint32_t pwait;                                     // parser thread waits on $head ( only it clears the flag )
+};
+
 /*
  * -----------------
  * Global Constants
@@ -179,6 +500,7 @@ struct sh_row_t {
 // Delimiters
 const char *CMD_DEL = " \r\n\t,~`";
 const char *ROW_DEL = "|&;";
+const char *STR_DEL = "\"'";
 const char *DEL_ARR[] = {"||", "|", "&&", "&", ";"};
 
 // Prompt data
@@ -192,15 +514,56 @@ const char *PROMPT_MESSAGE = "charisoudis_9026";
  * Static variables should be initialized once, and from then on be used as consts
  *
  */
+// Process environment ( passed to posix_spawn() )
+extern char **environ;
+
 // Shell Initialization
 static pid_t SH_PID, SH_PGID;
 static struct termios SH_TMODES;
-static char SH_MODE;        // 'i': interactive | 'b': batch | 'm': mixed
+static char SH_MODE;        // 'i': interactive | 'b': batch | 'm': mixed | 'c': single row ( -c ) | 's': stdin stream
+static bool SH_HEADLESS;    // started with -c / -f or stdin not a terminal: no confirmations, banners or screen
+                            // clears, stderr is kept
 static bool SH_STATUS;      // main() return status
 static char *SH_WD_I;       // initial working directory
+static size_t SH_JOBS;      // rows of a batch file executed at once ( -j, 0 if not given )
+static bool SH_INCREMENTAL; // skip batch file rows that succeeded last time with the same inputs ( -i )
+static bool SH_RESUME;      // continue a batch file from its checkpoint journal ( --resume )
+
+// Built-in command requests channel ( children send on WRITE_EDGE, main process serves READ_EDGE )
+static int SH_IPC_FD[2] = {-1, -1};
+
+// Event loop of the main process ( requests, signals and input, see sh_ipc_poll() )
+static int SH_EPOLL_FD = -1;
+static int SH_SIG_FD = -1;          // signalfd of SIGCHLD, SIGINT ( blocked in the main process )
+static int SH_EPOLL_IN = -1;        // input descriptor registered last ( one-shot )
+static bool SH_EPOLL_ARMED;         // $SH_EPOLL_IN is armed
+static sigset_t SH_SIGMASK;         // signal mask before blocking ( restored in children )
+static posix_spawnattr_t SH_SPAWNATTR; // posix_spawn() attributes ( restore $SH_SIGMASK )
+
+// Runtime configuration ( cached SH_* environment variables, see sh_conf_sync() )
+static sh_conf_t SH_CONF;
+
+// Per-row memory ( rows release it with sh_arena_release() after execution, one per thread )
+static __thread sh_arena_t SH_ARENA;
+
+// Debugging is off in this thread ( see SH_DBG() )
+static __thread bool SH_DBG_MUTE;
+
+// Row scanner's byte classes ( see sh_scan_init() )
+static unsigned char SH_SCAN_CLS[256];
+
+// Built-in commands' perfect hash ( slot -> 1 + index in $SH_BUILTIN_CMDS, 0 if free, see sh_blt_init() )
+static unsigned char SH_BLT_IDX[1 << BLT_IDX_BITS];
+static uint32_t SH_BLT_SEED;
 
-// Shared memory for 1KB
-static void *SH_SHARED_MEMORY_PTR;
+// Resolved commands of $PATH ( command name -> absolute path )
+static sh_pathidx_t SH_PATH_INDEX;
+
+// Parsed rows ( trimmed row -> plan, least recently used are evicted )
+static sh_plancache_t SH_PLAN_CACHE;
+
+// Background jobs ( job id / pid -> job )
+static sh_jobtab_t SH_JOBTAB;
 
 // Util pointers
 static sh_cmdops_t *cmdutils;
@@ -228,52 +591,124 @@ bool sh_cmd_iscomment ( sh_cmd_t * );
 bool sh_cmd_isempty ( sh_cmd_t * );
 
 bool sh_cmd_isvalid ( sh_cmd_t * );
-void sh_cmd_trim ( sh_cmd_t * );
 void sh_cmd_parse ( sh_cmd_t * );
 void sh_cmd_inspect ( sh_cmd_t * );
 
 // Row Methods
 void sh_row_parse ( sh_row_t * );
+void sh_row_plan ( sh_row_t * );
 void sh_row_inspect ( sh_row_t * );
 bool sh_row_exec ( sh_row_t * );
 
+// Row scanner
+void sh_scan_init ( void );
+bool sh_scan ( sh_arena_t *, const char *, size_t, sh_scan_t * );
+
+// Arena
+void *sh_arena_alloc ( sh_arena_t *, size_t );
+sh_mark_t sh_arena_mark ( const sh_arena_t * );
+void sh_arena_release ( sh_arena_t *, sh_mark_t );
+void sh_arena_free ( sh_arena_t * );
+
+// Plan cache
+sh_planent_t *sh_plan_lookup ( const char *, size_t, size_t );
+void sh_plan_insert ( const sh_row_t *, size_t );
+void sh_plan_flush ( void );
+
 // Executors
-bool sh_parse_exec_row ( const char * );
+bool sh_parse_exec_row ( const char *, size_t );
+bool sh_row_load ( const char *, size_t, sh_row_t *, bool );
+bool sh_batch_parallel ( sh_reader_t *, size_t, sh_inc_t *, sh_ckpt_t * );
+bool sh_batch_dag ( sh_reader_t *, size_t, sh_ckpt_t * );
 bool sh_exec_minor_command_set ( const sh_row_t *, size_t, size_t );
-bool sh_exec_major_command_set ( const sh_row_t *, size_t, size_t );
+bool sh_exec_plan ( const sh_row_t *, size_t );
 bool sh_exec_wrapper ( sh_cmd_t *, size_t, int ** );
+pid_t sh_exec_spawn ( sh_cmd_t *, size_t, size_t, int ** );
 void sh_exec_response ( size_t, int ** );
 bool sh_exec_builtin ( sh_cmd_t * );
+
+// Built-in command requests ( main process )
+bool sh_ipc_init ( void );
+bool sh_ipc_request ( const sh_cmd_t * );
+void sh_ipc_serve ( void );
+pid_t sh_waitpid ( pid_t, int * );
+void sh_wait_input ( int );
+unsigned int sh_sleep ( unsigned int );
+
 bool sh_exec ( sh_cmd_t * );
 
+// Incremental batch execution
+bool sh_inc_open ( sh_inc_t *, const char * );
+bool sh_inc_skip ( sh_inc_t *, const char *, size_t, size_t * );
+void sh_inc_done ( sh_inc_t *, size_t );
+bool sh_inc_close ( sh_inc_t *, bool );
+
+// Job table
+size_t sh_job_add ( pid_t, char * );
+sh_job_t *sh_job_find ( pid_t );
+sh_job_t *sh_job_get ( const char * );
+void sh_job_update ( pid_t, int );
+void sh_job_reap ( void );
+void sh_job_notify ( void );
+void sh_job_flush ( void );
+
+// Look-ahead parsing
+bool sh_ahead_start ( sh_aqueue_t *, sh_reader_t *, size_t );
+sh_ahead_t *sh_ahead_next ( sh_aqueue_t * );
+bool sh_ahead_exec ( sh_ahead_t * );
+void sh_ahead_pop ( sh_aqueue_t * );
+void sh_ahead_stop ( sh_aqueue_t * );
+
+// Batch checkpoints
+bool sh_ckpt_open ( sh_ckpt_t *, const char *, int );
+bool sh_ckpt_skip ( const sh_ckpt_t *, size_t, const char *, size_t );
+void sh_ckpt_done ( sh_ckpt_t *, size_t, bool );
+void sh_ckpt_close ( sh_ckpt_t *, bool );
+
+// Row reader
+bool sh_reader_init ( sh_reader_t *, int, bool );
+const char *sh_reader_next ( sh_reader_t *, size_t * );
+void sh_reader_free ( sh_reader_t * );
+
 // Utilities
 size_t sh_strlen ( const char * );
 size_t sh_ntokens ( const char *, const char * );
 size_t sh_cmd_lt_arg_exists( sh_cmd_t * );
 size_t sh_cmd_gt_arg_exists( sh_cmd_t * );
-bool sh_quit ( const char * );
+bool sh_quit ( const char *, size_t );
 void sh_inspect_pipes ( int **, size_t );
 char *sh_file_exists ( const char * );
+int sh_tmpfd ( void );
+
+// PATH index
+void sh_path_sync ( void );
+void sh_path_flush ( void );
+const char *sh_path_lookup ( const char * );
 
 // Set / Get environment variables
 int sh_get_env ( const char *, int );
 void sh_set_env ( const char *, int );
+void sh_conf_sync ( const char * );
 
 // Printers
 void sh_prt_welcome ( void );
 void sh_prt_bye ( void );
 
-// Signal handlers
-void sh_SIGUSR2_handler ( int ); // only main process listens to SIGUSR2 to update its environment
-void sh_SIGCHLD_handler ( int ); // SIGCHLD received when child dies
-void sh_SIGINT_handler ( int );  // SIGINT received when user presses Ctrl + C
+// Signal events ( read from $SH_SIG_FD )
+void sh_sig_serve ( void );     // drain pending signals
+void sh_sig_int ( void );       // SIGINT received when user presses Ctrl + C
+pid_t sh_fork ( void );         // fork() restoring the signal mask in the child
 
 // Operation modes
 bool mode_i ( bool );
 
 bool mode_b ( const char * );
 
+bool mode_s ( int );
+
 // Built-in commands
+void sh_blt_init ( void );
+sh_bltcmd_t *sh_blt_lookup ( const char * );
 bool sh_bltcmd_cd ( const sh_cmd_t * );
 bool sh_bltcmd_set ( const sh_cmd_t * );
 bool sh_bltcmd_unset ( const sh_cmd_t * );
@@ -282,6 +717,11 @@ bool sh_bltcmd_cls ( const sh_cmd_t * );
 bool sh_bltcmd_sleep ( const sh_cmd_t * );
 bool sh_bltcmd_help ( const sh_cmd_t * );
 bool sh_bltcmd_exit ( const sh_cmd_t * );
+bool sh_bltcmd_jobs ( const sh_cmd_t * );
+bool sh_bltcmd_fg ( const sh_cmd_t * );
+bool sh_bltcmd_bg ( const sh_cmd_t * );
+bool sh_bltcmd_wait ( const sh_cmd_t * );
+bool sh_bltcmd_kill ( const sh_cmd_t * );
 
 /*
  * -----------------------------
@@ -297,5 +737,28 @@ sh_bltcmd_t SH_BUILTIN_CMDS[] = {
         {"clear", true,  sh_bltcmd_cls},     // clear screen
         {"sleep", false, sh_bltcmd_sleep},   // clear screen
         {"help",  false, sh_bltcmd_help},    // get useful info about built in commands
-        {"exit",  true,  sh_bltcmd_exit}     // similar to quit raw data
-};
\ No newline at end of file
+        {"exit",  true,  sh_bltcmd_exit},    // similar to quit raw data
+        {"jobs",  true,  sh_bltcmd_jobs},    // list background jobs
+        {"fg",    true,  sh_bltcmd_fg},      // bring a job to foreground
+        {"bg",    true,  sh_bltcmd_bg},      // continue a stopped job in background
+        {"wait",  true,  sh_bltcmd_wait},    // wait for jobs to finish
+        {"kill",  true,  sh_bltcmd_kill}     // signal jobs or processes
+};
+
+/*
+ * ---------------------------------
+ * Runtime configuration definition
+ * ---------------------------------
+ *
+ */
+sh_confvar_t SH_CONF_VARS[] = {
+        {SH_DBG_MODE_KEY,              SH_DBG_MODE_DEFAULT,              &SH_CONF.dbg_mode},
+        {SH_SHOW_WD_KEY,               SH_SHOW_WD_DEFAULT,               &SH_CONF.show_wd},
+        {SH_ON_ROW_ERR_ABRT_KEY,       SH_ON_ROW_ERR_ABRT_DEFAULT,       &SH_CONF.on_row_err_abrt},
+        {SH_ON_FROW_ERR_ABRT_KEY,      SH_ON_FROW_ERR_ABRT_DEFAULT,      &SH_CONF.on_frow_err_abrt},
+        {SH_ON_CMD_FAIL_SEARCH_BF_KEY, SH_ON_CMD_FAIL_SEARCH_BF_DEFAULT, &SH_CONF.on_cmd_fail_search_bf},
+        {SH_DIRECT_OUT_KEY,            SH_DIRECT_OUT_DEFAULT,            &SH_CONF.direct_out},
+        {SH_SPAWN_MODE_KEY,            SH_SPAWN_MODE_DEFAULT,            &SH_CONF.spawn_mode},
+        {SH_PLAN_CACHE_KEY,            SH_PLAN_CACHE_DEFAULT,            &SH_CONF.plan_cache},
+        {SH_PARSE_AHEAD_KEY,           SH_PARSE_AHEAD_DEFAULT,           &SH_CONF.parse_ahead}
+};